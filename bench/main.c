@@ -0,0 +1,582 @@
+/*==============================================================================
+ dbsdk native benchmarks
+ -------------------------------
+ Times the hot paths of the SDK C sources on the development machine, linked
+ against the host import stubs in stubs.c. Run via `bb bench`, optionally
+ passing a substring to only run matching benchmarks.
+
+ Each benchmark prints one JSON object per line to stdout:
+   {"benchmark": ..., "batch": ..., "iterations": ..., "ns_per_batch": ...,
+    "ns_per_op": ..., "host_calls_per_batch": ...}
+ `batch` is the number of operations timed together, `iterations` the number
+ of batches run. Host calls are counted by the stubs and are a proxy for the
+ cost of crossing into the DreamBox runtime, which native timing can't show.
+ =============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stubs.h"
+#include "db_math.h"
+#include "db_sounddriver.h"
+#include "db_broadphase.h"
+#include "db_stream.h"
+#include "db_lz4.h"
+#include "db_input.h"
+
+// Internal to db_sounddriver.c
+extern void update_voice(sound_emitter *emitter, float gain, float pan, double t);
+
+#define MIN_BENCH_NS 200000000ULL
+
+typedef struct
+{
+    const char *name;
+    uint32_t batch;
+    void (*setup)(uint32_t batch);
+    void (*run)(uint32_t batch);
+    void (*teardown)(uint32_t batch);
+} benchmark;
+
+// Written to by the benchmarks so the compiler can't discard their results.
+volatile float sink;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Deterministic xorshift so runs are comparable.
+static uint32_t _rngState = 0x9E3779B9;
+
+static float randf(float min, float max)
+{
+    _rngState ^= _rngState << 13;
+    _rngState ^= _rngState >> 17;
+    _rngState ^= _rngState << 5;
+    return min + (max - min) * ((_rngState & 0xFFFFFF) / (float)0xFFFFFF);
+}
+
+static Vec3 randVec3(float extent)
+{
+    return (Vec3){randf(-extent, extent), randf(-extent, extent), randf(-extent, extent)};
+}
+
+static Quaternion randQuat()
+{
+    Quaternion q = quat_fromEuler(randVec3(PI));
+    quat_normalize(&q);
+    return q;
+}
+
+// db_math
+
+static Mat4 *_matA;
+static Mat4 *_matB;
+static Mat4 *_matOut;
+static Vec4 *_vec4In;
+static Vec4 *_vec4Out;
+static Vec3 *_vec3In;
+static Vec3 *_vec3Out;
+static Quaternion _rot;
+
+static void setup_mat4_mul(uint32_t batch)
+{
+    _matA = malloc(sizeof(Mat4) * batch);
+    _matB = malloc(sizeof(Mat4) * batch);
+    _matOut = malloc(sizeof(Mat4) * batch);
+
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _matA[i] = mat4_mul(mat4_translate(randVec3(100.0f)), mat4_rotation(randQuat()));
+        _matB[i] = mat4_mul(mat4_scale(randVec3(2.0f)), mat4_rotation(randQuat()));
+    }
+}
+
+static void run_mat4_mul(uint32_t batch)
+{
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _matOut[i] = mat4_mul(_matA[i], _matB[i]);
+    }
+    sink = _matOut[batch - 1].m[3][3];
+}
+
+static void teardown_mat4_mul(uint32_t batch)
+{
+    free(_matA);
+    free(_matB);
+    free(_matOut);
+}
+
+static void setup_vec4_transform(uint32_t batch)
+{
+    _matA = malloc(sizeof(Mat4));
+    _vec4In = malloc(sizeof(Vec4) * batch);
+    _vec4Out = malloc(sizeof(Vec4) * batch);
+
+    _matA[0] = mat4_mul(mat4_translate(randVec3(100.0f)), mat4_rotation(randQuat()));
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        Vec3 v = randVec3(100.0f);
+        _vec4In[i] = (Vec4){v.x, v.y, v.z, 1.0f};
+    }
+}
+
+static void run_vec4_transform(uint32_t batch)
+{
+    Mat4 mat = _matA[0];
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _vec4Out[i] = vec4_transform(mat, _vec4In[i]);
+    }
+    sink = _vec4Out[batch - 1].w;
+}
+
+static void teardown_vec4_transform(uint32_t batch)
+{
+    free(_matA);
+    free(_vec4In);
+    free(_vec4Out);
+}
+
+static void setup_vec3_transformQuat(uint32_t batch)
+{
+    _vec3In = malloc(sizeof(Vec3) * batch);
+    _vec3Out = malloc(sizeof(Vec3) * batch);
+
+    _rot = randQuat();
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _vec3In[i] = randVec3(100.0f);
+    }
+}
+
+static void run_vec3_transformQuat(uint32_t batch)
+{
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _vec3Out[i] = vec3_transformQuat(_rot, _vec3In[i]);
+    }
+    sink = _vec3Out[batch - 1].z;
+}
+
+static void teardown_vec3_transformQuat(uint32_t batch)
+{
+    free(_vec3In);
+    free(_vec3Out);
+}
+
+// db_sounddriver
+
+static sound_handle *_emitters;
+
+static void setup_emitters(uint32_t batch)
+{
+    stub_reset();
+    sound_init();
+    sound_setListener(randVec3(10.0f), randQuat());
+
+    _emitters = malloc(sizeof(sound_handle) * batch);
+
+    sound_sample sample = {0, 22050};
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _emitters[i] = sound_play3D(i % 4, sample, i % 2, 1, 1.0f, 1.0f, randVec3(50.0f), 1 + (i % 3), 1.0f, 60.0f, 1.0f);
+    }
+}
+
+static void teardown_emitters(uint32_t batch)
+{
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        sound_destroy(_emitters[i]);
+    }
+    free(_emitters);
+}
+
+// Gain and pan change every call, like a moving 3D emitter
+static void run_update_voice(uint32_t batch)
+{
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        update_voice(sound_getEmitter(_emitters[i]), randf(0.0f, 1.0f), randf(-1.0f, 1.0f), 0.0);
+    }
+}
+
+// Footstep/impact style positional one-shots, no emitters involved
+static void run_playOneShot3D(uint32_t batch)
+{
+    sound_sample sample = {0, 22050};
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        sound_playOneShot3D(1, sample, 0, 1.0f, 1.0f, randVec3(50.0f), SOUND_ATTEN_INV_DISTANCE, 1.0f, 60.0f, 1.0f);
+    }
+}
+
+static void run_sound_update(uint32_t batch)
+{
+    stub_advanceTime(1.0 / 60.0);
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        sound_setPosition(_emitters[i], randVec3(50.0f));
+    }
+    sound_update();
+}
+
+// Sample loading. Batch is the number of sample frames in the WAV file.
+
+static uint8_t *_wavBytes;
+
+static void setup_wav(uint32_t batch, uint16_t bitsPerSample)
+{
+    uint32_t dataLen = batch * (bitsPerSample / 8);
+    _wavBytes = malloc(44 + dataLen);
+
+    uint8_t *w = _wavBytes;
+    uint32_t riffLen = 36 + dataLen;
+    uint32_t fmtLen = 16;
+    uint16_t format = 1;
+    uint16_t channels = 1;
+    uint32_t rate = 22050;
+    uint32_t byteRate = rate * (bitsPerSample / 8);
+    uint16_t blockAlign = bitsPerSample / 8;
+
+    memcpy(w, "RIFF", 4);
+    memcpy(w + 4, &riffLen, 4);
+    memcpy(w + 8, "WAVEfmt ", 8);
+    memcpy(w + 16, &fmtLen, 4);
+    memcpy(w + 20, &format, 2);
+    memcpy(w + 22, &channels, 2);
+    memcpy(w + 24, &rate, 4);
+    memcpy(w + 28, &byteRate, 4);
+    memcpy(w + 32, &blockAlign, 2);
+    memcpy(w + 34, &bitsPerSample, 2);
+    memcpy(w + 36, "data", 4);
+    memcpy(w + 40, &dataLen, 4);
+
+    for (uint32_t i = 0; i < dataLen; i++)
+    {
+        w[44 + i] = (uint8_t)(randf(0.0f, 255.0f));
+    }
+}
+
+static void setup_wav8(uint32_t batch)
+{
+    setup_wav(batch, 8);
+}
+
+static void setup_wav16(uint32_t batch)
+{
+    setup_wav(batch, 16);
+}
+
+static void run_loadWavBytes(uint32_t batch)
+{
+    // released every run so each load is a full upload rather than a sample cache hit
+    sound_sample sample = sound_loadWavBytes(_wavBytes);
+    sink = (float)sample.length;
+    sound_releaseSample(sample);
+}
+
+static void run_loadWavBytesCached(uint32_t batch)
+{
+    sink = (float)sound_loadWavBytes(_wavBytes).length;
+}
+
+static void teardown_wav(uint32_t batch)
+{
+    free(_wavBytes);
+}
+
+// db_stream
+//
+// A parser reading a file 4 bytes at a time, straight through fs_read versus
+// through a buffered stream_Reader. Batch is the number of reads.
+
+static uint8_t *_fileBytes;
+static stub_file _file;
+static stream_Reader _reader;
+
+static void setup_file(uint32_t batch)
+{
+    _fileBytes = malloc(batch * 4);
+    for (uint32_t i = 0; i < batch * 4; i++)
+    {
+        _fileBytes[i] = (uint8_t)i;
+    }
+
+    stub_openMemory(&_file, _fileBytes, batch * 4);
+    stream_open(&_reader, &_file, 0);
+}
+
+static void run_fs_read(uint32_t batch)
+{
+    uint32_t sum = 0;
+    fs_seek(&_file, 0, IO_WHENCE_BEGIN);
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t v;
+        fs_read(&_file, &v, 4);
+        sum += v;
+    }
+
+    sink = (float)sum;
+}
+
+static void run_stream_read(uint32_t batch)
+{
+    uint32_t sum = 0;
+    stream_seek(&_reader, 0);
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        uint32_t v;
+        stream_read(&_reader, &v, 4);
+        sum += v;
+    }
+
+    sink = (float)sum;
+}
+
+static void teardown_file(uint32_t batch)
+{
+    stream_close(&_reader);
+    free(_fileBytes);
+}
+
+// db_lz4
+//
+// Decompress a hand-encoded block of batch bytes: sequences of 8 literals
+// followed by a 56 byte match, roughly the 8:1 mix of a tiled texture.
+
+static uint8_t *_lz4Block;
+static uint32_t _lz4BlockLen;
+static uint8_t *_lz4Out;
+
+static void setup_lz4(uint32_t batch)
+{
+    _lz4Block = malloc(batch);
+    _lz4Out = malloc(batch);
+
+    uint8_t *op = _lz4Block;
+    uint32_t decoded = 0;
+    while (batch - decoded >= 64 + 16)
+    {
+        // 8 literals, match length 56 = 4 + 15 + 37
+        *op++ = (8 << 4) | 15;
+        for (int i = 0; i < 8; i++)
+        {
+            *op++ = (uint8_t)(decoded + i * 37);
+        }
+        *op++ = 8;
+        *op++ = 0;
+        *op++ = 37;
+        decoded += 64;
+    }
+
+    // the block ends in a literal-only sequence
+    uint32_t lastLen = batch - decoded;
+    *op++ = 15 << 4;
+    for (uint32_t len = lastLen - 15; ; len -= 255)
+    {
+        *op++ = (uint8_t)(len >= 255 ? 255 : len);
+        if (len < 255)
+            break;
+    }
+    memset(op, 0x5A, lastLen);
+    op += lastLen;
+
+    _lz4BlockLen = (uint32_t)(op - _lz4Block);
+}
+
+static void run_lz4(uint32_t batch)
+{
+    sink = (float)lz4_decompressBlock(_lz4Block, _lz4BlockLen, _lz4Out, batch);
+}
+
+static void teardown_lz4(uint32_t batch)
+{
+    free(_lz4Block);
+    free(_lz4Out);
+}
+
+// db_broadphase
+//
+// Entities wander around a 200x200x20 area. Both benchmarks report overlapping
+// pairs; the naive version is the O(n^2) vec3_distanceSq loop the broadphase
+// replaces.
+
+#define ENTITY_RADIUS 1.0f
+
+static broadphase_Grid _grid;
+static Vec3 *_positions;
+static uint32_t *_entityIds;
+static broadphase_Pair *_pairs;
+
+static void setup_entities(uint32_t batch)
+{
+    _positions = malloc(sizeof(Vec3) * batch);
+    _entityIds = malloc(sizeof(uint32_t) * batch);
+    _pairs = malloc(sizeof(broadphase_Pair) * batch * 8);
+
+    broadphase_init(&_grid, ENTITY_RADIUS * 4.0f, batch, batch * 8);
+
+    Vec3 extent = (Vec3){ENTITY_RADIUS, ENTITY_RADIUS, ENTITY_RADIUS};
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _positions[i] = (Vec3){randf(-100.0f, 100.0f), randf(-100.0f, 100.0f), randf(-10.0f, 10.0f)};
+        _entityIds[i] = broadphase_insert(&_grid, vec3_sub(_positions[i], extent), vec3_add(_positions[i], extent), i);
+    }
+}
+
+static void teardown_entities(uint32_t batch)
+{
+    broadphase_destroy(&_grid);
+    free(_positions);
+    free(_entityIds);
+    free(_pairs);
+}
+
+static void move_entities(uint32_t batch)
+{
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        _positions[i] = vec3_add(_positions[i], randVec3(0.25f));
+    }
+}
+
+static void run_broadphase_pairs(uint32_t batch)
+{
+    move_entities(batch);
+
+    Vec3 extent = (Vec3){ENTITY_RADIUS, ENTITY_RADIUS, ENTITY_RADIUS};
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        broadphase_update(&_grid, _entityIds[i], vec3_sub(_positions[i], extent), vec3_add(_positions[i], extent));
+    }
+
+    sink = (float)broadphase_findPairs(&_grid, _pairs, batch * 8);
+}
+
+static void run_naive_pairs(uint32_t batch)
+{
+    move_entities(batch);
+
+    uint32_t found = 0;
+    float range = (ENTITY_RADIUS * 2.0f) * (ENTITY_RADIUS * 2.0f);
+    for (uint32_t a = 0; a < batch; a++)
+    {
+        for (uint32_t b = a + 1; b < batch; b++)
+        {
+            if (vec3_distanceSq(_positions[a], _positions[b]) <= range && found < batch * 8)
+            {
+                _pairs[found++] = (broadphase_Pair){a, b};
+            }
+        }
+    }
+
+    sink = (float)found;
+}
+
+static void run_sound_update_static(uint32_t batch)
+{
+    stub_advanceTime(1.0 / 60.0);
+    sound_update();
+}
+
+static void setup_input(uint32_t batch)
+{
+}
+
+// a frame of polling for four players: read the pads + check each for presses
+static void run_input_update(uint32_t batch)
+{
+    uint32_t pressed = 0;
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        input_update();
+        for (uint32_t port = 0; port < INPUT_PORTS; port++)
+        {
+            pressed += input_pressed(port) + input_pressedWithin(port, GAMEPAD_BTN_A, 0, 8);
+        }
+    }
+
+    sink = (float)pressed;
+}
+
+static void teardown_input(uint32_t batch)
+{
+}
+
+static const benchmark _benchmarks[] = {
+    {"mat4_mul", 1024, setup_mat4_mul, run_mat4_mul, teardown_mat4_mul},
+    {"vec4_transform", 4096, setup_vec4_transform, run_vec4_transform, teardown_vec4_transform},
+    {"vec3_transformQuat", 4096, setup_vec3_transformQuat, run_vec3_transformQuat, teardown_vec3_transformQuat},
+    {"update_voice", 32, setup_emitters, run_update_voice, teardown_emitters},
+    {"sound_playOneShot3D", 32, setup_emitters, run_playOneShot3D, teardown_emitters},
+    {"sound_update/32", 32, setup_emitters, run_sound_update, teardown_emitters},
+    {"sound_update/128", 128, setup_emitters, run_sound_update, teardown_emitters},
+    {"sound_update/256", 256, setup_emitters, run_sound_update, teardown_emitters},
+    {"sound_update_static/32", 32, setup_emitters, run_sound_update_static, teardown_emitters},
+    {"sound_loadWavBytes/s8", 1 << 20, setup_wav8, run_loadWavBytes, teardown_wav},
+    {"sound_loadWavBytes/s16", 1 << 20, setup_wav16, run_loadWavBytes, teardown_wav},
+    {"sound_loadWavBytes/s16_cached", 1 << 20, setup_wav16, run_loadWavBytesCached, teardown_wav},
+    {"fs_read/4B", 4096, setup_file, run_fs_read, teardown_file},
+    {"stream_read/4B", 4096, setup_file, run_stream_read, teardown_file},
+    {"lz4_decompressBlock/64K", 65536, setup_lz4, run_lz4, teardown_lz4},
+    {"input_update/60", 60, setup_input, run_input_update, teardown_input},
+    {"broadphase_findPairs/512", 512, setup_entities, run_broadphase_pairs, teardown_entities},
+    {"naive_pairs/512", 512, setup_entities, run_naive_pairs, teardown_entities},
+};
+
+static void run_benchmark(const benchmark *bench)
+{
+    bench->setup(bench->batch);
+
+    // Warm up caches and branch predictors before timing.
+    bench->run(bench->batch);
+
+    uint64_t iterations = 0;
+    uint64_t hostCalls = stub_hostCalls;
+    uint64_t start = now_ns();
+    uint64_t elapsed = 0;
+
+    while (elapsed < MIN_BENCH_NS)
+    {
+        bench->run(bench->batch);
+        iterations++;
+        elapsed = now_ns() - start;
+    }
+
+    hostCalls = stub_hostCalls - hostCalls;
+
+    double nsPerBatch = (double)elapsed / (double)iterations;
+    printf("{\"benchmark\": \"%s\", \"batch\": %u, \"iterations\": %llu, \"ns_per_batch\": %.1f, \"ns_per_op\": %.2f, \"host_calls_per_batch\": %.1f}\n",
+           bench->name,
+           bench->batch,
+           (unsigned long long)iterations,
+           nsPerBatch,
+           nsPerBatch / bench->batch,
+           (double)hostCalls / (double)iterations);
+    fflush(stdout);
+
+    bench->teardown(bench->batch);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : NULL;
+
+    for (size_t i = 0; i < sizeof(_benchmarks) / sizeof(_benchmarks[0]); i++)
+    {
+        if (filter == NULL || strstr(_benchmarks[i].name, filter) != NULL)
+        {
+            run_benchmark(&_benchmarks[i]);
+        }
+    }
+
+    return 0;
+}
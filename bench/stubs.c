@@ -0,0 +1,341 @@
+/*==============================================================================
+ Host import stubs
+ -------------------------------
+ Native stand-ins for the DreamBox host imports used by the SDK C sources so
+ they can be compiled and timed on the development machine. The stubs do as
+ little work as possible, but each one bumps `stub_hostCalls` so benchmarks
+ can report how many imports a piece of code would have made.
+ =============================================================================*/
+#include <stdio.h>
+#include <string.h>
+
+#include "stubs.h"
+#include "db_audio.h"
+#include "db_gamepad.h"
+#include "db_io.h"
+#include "db_log.h"
+#include "db_math.h"
+#include "db_vdp.h"
+
+uint64_t stub_hostCalls = 0;
+uint8_t stub_voiceState[32];
+
+static double _audioTime = 0.0;
+static int32_t _nextSampleHandle = 0;
+
+void stub_reset()
+{
+    stub_hostCalls = 0;
+    _audioTime = 0.0;
+    memset(stub_voiceState, 0, sizeof(stub_voiceState));
+}
+
+void stub_advanceTime(double seconds)
+{
+    _audioTime += seconds;
+}
+
+// db_log
+
+void db_log(const char *msg)
+{
+    stub_hostCalls++;
+    fprintf(stderr, "[db_log] %s\n", msg);
+}
+
+// db_math
+//
+// The SIMD matrix unit is emulated with the scalar db_math routines.
+
+static Mat4 _simdMatrix;
+
+void mat4_loadSIMD(const Mat4 *mat)
+{
+    stub_hostCalls++;
+    _simdMatrix = *mat;
+}
+
+void mat4_storeSIMD(Mat4 *mat)
+{
+    stub_hostCalls++;
+    *mat = _simdMatrix;
+}
+
+void mat4_mulSIMD(const Mat4 *mat)
+{
+    stub_hostCalls++;
+    _simdMatrix = mat4_mul(_simdMatrix, *mat);
+}
+
+void mat4_transformSIMD(const Vec4 *invec, Vec4 *outvec, uint32_t count, uint32_t stride)
+{
+    stub_hostCalls++;
+    if (stride == 0)
+        stride = sizeof(Vec4);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const Vec4 *in = (const Vec4 *)((const uint8_t *)invec + i * stride);
+        Vec4 *out = (Vec4 *)((uint8_t *)outvec + i * stride);
+        *out = vec4_transform(_simdMatrix, *in);
+    }
+}
+
+// db_audio
+
+int32_t audio_alloc(const void *dataPtr, uint32_t dataLen, uint32_t audioFmt)
+{
+    stub_hostCalls++;
+    return _nextSampleHandle++;
+}
+
+int32_t audio_allocCompressed(const void *dataPtr, uint32_t dataLen, uint32_t blockSize)
+{
+    stub_hostCalls++;
+    return _nextSampleHandle++;
+}
+
+void audio_free(int32_t handle)
+{
+    stub_hostCalls++;
+}
+
+uint32_t audio_getUsage()
+{
+    stub_hostCalls++;
+    return 0;
+}
+
+uint8_t audio_getVoiceState(uint32_t slot)
+{
+    stub_hostCalls++;
+    return stub_voiceState[slot];
+}
+
+void audio_queueSetParam_i(uint32_t slot, uint32_t param, int32_t value, double time)
+{
+    stub_hostCalls++;
+}
+
+void audio_queueSetParam_f(uint32_t slot, uint32_t param, float value, double time)
+{
+    stub_hostCalls++;
+}
+
+void audio_queueStartVoice(uint32_t slot, double time)
+{
+    stub_hostCalls++;
+    stub_voiceState[slot] = 1;
+}
+
+void audio_queueStopVoice(uint32_t slot, double time)
+{
+    stub_hostCalls++;
+    stub_voiceState[slot] = 0;
+}
+
+double audio_getTime()
+{
+    stub_hostCalls++;
+    return _audioTime;
+}
+
+void audio_setReverbParams(float roomSize, float damp, float width, float wet, float dry)
+{
+    stub_hostCalls++;
+}
+
+uint8_t audio_initSynth(void *sf2Data, uint32_t sf2DataLen)
+{
+    stub_hostCalls++;
+    return 1;
+}
+
+uint8_t audio_playMidi(void *smfData, uint32_t smfDataLen, uint8_t loop)
+{
+    stub_hostCalls++;
+    return 1;
+}
+
+void audio_setMidiVolume(float volume)
+{
+    stub_hostCalls++;
+}
+
+void audio_setMidiReverb(uint8_t enabled)
+{
+    stub_hostCalls++;
+}
+
+// db_io
+//
+// Files are in-memory blobs described by a stub_file. Directories and the
+// memory card are not supported.
+
+IOFILE *stub_openMemory(stub_file *file, const uint8_t *data, uint32_t length)
+{
+    file->data = data;
+    file->length = length;
+    file->position = 0;
+    return file;
+}
+
+uint8_t fs_deviceExists(const char *device)
+{
+    stub_hostCalls++;
+    return 1;
+}
+
+void fs_deviceEject(const char *device)
+{
+    stub_hostCalls++;
+}
+
+uint8_t fs_fileExists(const char *filepath)
+{
+    stub_hostCalls++;
+    return 0;
+}
+
+IOFILE *fs_open(const char *filepath, uint32_t mode)
+{
+    stub_hostCalls++;
+    return NULL;
+}
+
+IOFILE *fs_allocMemoryCard(const char *filename, const void *icon, const uint16_t *iconPalette, uint32_t numBlocks)
+{
+    stub_hostCalls++;
+    return NULL;
+}
+
+uint32_t fs_read(IOFILE *filehandle, void *buffer, uint32_t readLen)
+{
+    stub_hostCalls++;
+    stub_file *file = (stub_file *)filehandle;
+
+    uint32_t remaining = file->length - file->position;
+    if (readLen > remaining)
+        readLen = remaining;
+
+    memcpy(buffer, file->data + file->position, readLen);
+    file->position += readLen;
+    return readLen;
+}
+
+uint32_t fs_write(IOFILE *filehandle, const void *buffer, uint32_t readLen)
+{
+    stub_hostCalls++;
+    return (uint32_t)-1;
+}
+
+uint32_t fs_seek(IOFILE *filehandle, int32_t position, uint32_t whence)
+{
+    stub_hostCalls++;
+    stub_file *file = (stub_file *)filehandle;
+
+    int64_t origin = 0;
+    if (whence == IO_WHENCE_CURRENT)
+        origin = file->position;
+    else if (whence == IO_WHENCE_END)
+        origin = file->length;
+
+    int64_t target = origin + position;
+    if (target < 0)
+        target = 0;
+    if (target > file->length)
+        target = file->length;
+
+    file->position = (uint32_t)target;
+    return file->position;
+}
+
+void fs_flush(IOFILE *filehandle)
+{
+    stub_hostCalls++;
+}
+
+uint32_t fs_tell(IOFILE *filehandle)
+{
+    stub_hostCalls++;
+    return ((stub_file *)filehandle)->position;
+}
+
+uint8_t fs_eof(IOFILE *filehandle)
+{
+    stub_hostCalls++;
+    stub_file *file = (stub_file *)filehandle;
+    return file->position >= file->length;
+}
+
+void fs_close(IOFILE *filehandle)
+{
+    stub_hostCalls++;
+}
+
+IODIR *fs_openDir(const char *path)
+{
+    stub_hostCalls++;
+    return NULL;
+}
+
+IODIRENT *fs_readDir(IODIR *dirHandle)
+{
+    stub_hostCalls++;
+    return NULL;
+}
+
+void fs_rewindDir(IODIR *dirHandle)
+{
+    stub_hostCalls++;
+}
+
+void fs_closeDir(IODIR *dirHandle)
+{
+    stub_hostCalls++;
+}
+
+// db_vdp
+//
+// Only the texture calls made by the SDK sources are stubbed.
+
+static uint32_t _nextTextureHandle = 0;
+
+uint32_t vdp_allocTexture(uint8_t mipmap, uint32_t format, uint32_t width, uint32_t height)
+{
+    stub_hostCalls++;
+    return _nextTextureHandle++;
+}
+
+void vdp_setTextureData(uint32_t textureHandle, uint32_t level, const void *data, uint32_t dataLen)
+{
+    stub_hostCalls++;
+}
+
+// db_gamepad
+//
+// Every port has a pad connected, its buttons + sticks change each read.
+
+static uint16_t _nextButtons = 0;
+
+uint8_t gamepad_isConnected(uint32_t port)
+{
+    stub_hostCalls++;
+    return 1;
+}
+
+void gamepad_readState(uint32_t port, gamepad_State *state)
+{
+    stub_hostCalls++;
+    _nextButtons = (uint16_t)(_nextButtons * 31 + 7);
+    state->btnMask = _nextButtons;
+    state->lStickX = (int16_t)(_nextButtons * 3);
+    state->lStickY = (int16_t)(_nextButtons * 5);
+    state->rStickX = (int16_t)(_nextButtons * 7);
+    state->rStickY = (int16_t)(_nextButtons * 11);
+}
+
+void gamepad_setRumble(uint32_t port, uint8_t enable)
+{
+    stub_hostCalls++;
+}
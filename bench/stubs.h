@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_io.h"
+
+/// @brief Backing store for an in-memory IOFILE
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t length;
+    uint32_t position;
+} stub_file;
+
+/// @brief Number of host imports called since the last stub_reset
+extern uint64_t stub_hostCalls;
+
+/// @brief Value returned by audio_getVoiceState for each voice slot
+extern uint8_t stub_voiceState[32];
+
+/// @brief Reset the host call counter, audio clock, and voice states
+void stub_reset();
+
+/// @brief Advance the value returned by audio_getTime
+/// @param seconds Number of seconds to advance by
+void stub_advanceTime(double seconds);
+
+/// @brief Wrap a memory blob so it can be passed to the fs_* stubs
+/// @param file The stub_file to initialize
+/// @param data Pointer to the file contents
+/// @param length Length of the file contents
+/// @return A handle usable with fs_read, fs_seek, etc
+IOFILE *stub_openMemory(stub_file *file, const uint8_t *data, uint32_t length);
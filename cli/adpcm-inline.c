@@ -0,0 +1,383 @@
+/*==============================================================================
+ IMA ADPCM encoder
+ -------------------------------
+ Encodes PCM WAV files to IMA ADPCM WAV files (format_type 0x11) which the
+ DreamBox sound driver uploads with audio_allocCompressed. Each block starts
+ with a 4 byte header per channel (first sample + step index) followed by
+ 4-bit samples, so a block of N bytes holds (N - 4) * 2 + 1 mono samples.
+ Stereo blocks alternate 4 bytes (8 samples) of each channel.
+
+ Files are encoded in parallel, one file per worker thread. Windows builds
+ encode sequentially.
+ =============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+static const int adpcm_index_table[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int adpcm_step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+  19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+  130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+  876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+  5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+typedef struct {
+  int predictor;
+  int index;
+} adpcm_state;
+
+typedef struct {
+  uint16_t channels;
+  uint32_t sample_rate;
+  uint32_t frames;
+  int16_t *samples; // interleaved
+} adpcm_pcm;
+
+static uint16_t adpcm_read16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t adpcm_read32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void adpcm_write16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void adpcm_write32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// Encode one sample, updating the encoder state the same way the decoder will.
+static uint8_t adpcm_encode_sample(adpcm_state *state, int sample) {
+  int step = adpcm_step_table[state->index];
+  int diff = sample - state->predictor;
+  uint8_t nibble = 0;
+
+  if (diff < 0) {
+    nibble = 8;
+    diff = -diff;
+  }
+
+  int delta = step >> 3;
+  if (diff >= step) {
+    nibble |= 4;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 2;
+    diff -= step;
+    delta += step;
+  }
+  step >>= 1;
+  if (diff >= step) {
+    nibble |= 1;
+    delta += step;
+  }
+
+  state->predictor += (nibble & 8) ? -delta : delta;
+  if (state->predictor > 32767) state->predictor = 32767;
+  if (state->predictor < -32768) state->predictor = -32768;
+
+  state->index += adpcm_index_table[nibble];
+  if (state->index < 0) state->index = 0;
+  if (state->index > 88) state->index = 88;
+
+  return nibble;
+}
+
+// Samples per channel held by one block.
+static uint32_t adpcm_samples_per_block(uint32_t block_align, uint16_t channels) {
+  return (block_align - 4 * channels) * 2 / channels + 1;
+}
+
+// Read a PCM WAV file (8 or 16-bit, mono or stereo) into 16-bit samples.
+static const char *adpcm_read_wav(const char *path, adpcm_pcm *pcm) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return "could not open file";
+
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t *data = malloc(len > 0 ? (size_t)len : 1);
+  size_t read = data != NULL ? fread(data, 1, (size_t)len, f) : 0;
+  fclose(f);
+
+  if (data == NULL) return "out of memory";
+  if (read < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)) {
+    free(data);
+    return "not a WAV file";
+  }
+
+  const uint8_t *fmt = NULL;
+  const uint8_t *samples = NULL;
+  uint32_t samples_len = 0;
+
+  size_t pos = 12;
+  while (pos + 8 <= read) {
+    uint32_t chunk_len = adpcm_read32(data + pos + 4);
+    const uint8_t *chunk = data + pos + 8;
+    if (chunk_len > read - pos - 8) chunk_len = (uint32_t)(read - pos - 8);
+
+    if (!memcmp(data + pos, "fmt ", 4) && chunk_len >= 16) fmt = chunk;
+    else if (!memcmp(data + pos, "data", 4)) {
+      samples = chunk;
+      samples_len = chunk_len;
+    }
+
+    pos += 8 + chunk_len + (chunk_len & 1);
+  }
+
+  uint16_t format = fmt != NULL ? adpcm_read16(fmt) : 0;
+  uint16_t bits = fmt != NULL ? adpcm_read16(fmt + 14) : 0;
+  pcm->channels = fmt != NULL ? adpcm_read16(fmt + 2) : 0;
+  pcm->sample_rate = fmt != NULL ? adpcm_read32(fmt + 4) : 0;
+
+  const char *err = NULL;
+  if (fmt == NULL || samples == NULL) err = "missing fmt or data chunk";
+  else if (format == 0x11) err = "already IMA ADPCM";
+  else if (format != 1 || (bits != 8 && bits != 16)) err = "only 8 and 16-bit PCM can be encoded";
+  else if (pcm->channels != 1 && pcm->channels != 2) err = "only mono and stereo can be encoded";
+
+  if (err != NULL) {
+    free(data);
+    return err;
+  }
+
+  uint32_t count = samples_len / (bits / 8);
+  pcm->frames = count / pcm->channels;
+  pcm->samples = malloc(sizeof(int16_t) * (count > 0 ? count : 1));
+  if (pcm->samples == NULL) {
+    free(data);
+    return "out of memory";
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    pcm->samples[i] = bits == 8
+      ? (int16_t)((samples[i] - 128) << 8)
+      : (int16_t)adpcm_read16(samples + i * 2);
+  }
+
+  free(data);
+  return NULL;
+}
+
+// Encode PCM into whole blocks, padding the final block with silence.
+static uint8_t *adpcm_encode(const adpcm_pcm *pcm, uint32_t block_align, uint32_t *out_len) {
+  uint16_t channels = pcm->channels;
+  uint32_t per_block = adpcm_samples_per_block(block_align, channels);
+  uint32_t blocks = (pcm->frames + per_block - 1) / per_block;
+  if (blocks == 0) blocks = 1;
+
+  uint8_t *out = calloc(blocks, block_align);
+  if (out == NULL) return NULL;
+
+  adpcm_state state[2] = {{0, 0}, {0, 0}};
+  for (uint32_t b = 0; b < blocks; b++) {
+    uint8_t *block = out + b * block_align;
+    uint32_t first = b * per_block;
+
+    // Header: the first sample is stored verbatim and becomes the predictor.
+    for (uint16_t c = 0; c < channels; c++) {
+      int sample = first < pcm->frames ? pcm->samples[first * channels + c] : 0;
+      state[c].predictor = sample;
+      adpcm_write16(block + c * 4, (uint16_t)(int16_t)sample);
+      block[c * 4 + 2] = (uint8_t)state[c].index;
+      block[c * 4 + 3] = 0;
+    }
+
+    // Body: groups of 8 samples (4 bytes) per channel, low nibble first.
+    uint8_t *body = block + channels * 4;
+    uint32_t groups = (per_block - 1) / 8;
+    for (uint32_t g = 0; g < groups; g++) {
+      for (uint16_t c = 0; c < channels; c++) {
+        uint8_t *dst = body + (g * channels + c) * 4;
+        for (uint32_t s = 0; s < 8; s++) {
+          uint32_t frame = first + 1 + g * 8 + s;
+          int sample = frame < pcm->frames ? pcm->samples[frame * channels + c] : 0;
+          uint8_t nibble = adpcm_encode_sample(&state[c], sample);
+          dst[s / 2] |= (s & 1) ? (uint8_t)(nibble << 4) : nibble;
+        }
+      }
+    }
+  }
+
+  *out_len = blocks * block_align;
+  return out;
+}
+
+// Encode one WAV file. Returns NULL on success or a description of the error.
+static const char *adpcm_encode_file(const char *in_path, const char *out_path, uint32_t block_size, uint32_t *in_bytes, uint32_t *out_bytes) {
+  adpcm_pcm pcm;
+  const char *err = adpcm_read_wav(in_path, &pcm);
+  if (err != NULL) return err;
+
+  // Stereo blocks need a whole number of 4 byte groups per channel.
+  uint32_t align = 4 * pcm.channels;
+  uint32_t block_align = block_size - block_size % align;
+  if (block_align < align * 2) block_align = align * 2;
+  if (block_align > 65535) block_align = 65535 - 65535 % align;
+
+  uint32_t data_len;
+  uint8_t *data = adpcm_encode(&pcm, block_align, &data_len);
+  *in_bytes = pcm.frames * pcm.channels * 2;
+  free(pcm.samples);
+  if (data == NULL) return "out of memory";
+
+  uint32_t per_block = adpcm_samples_per_block(block_align, pcm.channels);
+
+  uint8_t header[60];
+  memcpy(header, "RIFF", 4);
+  adpcm_write32(header + 4, 52 + data_len);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  adpcm_write32(header + 16, 20);
+  adpcm_write16(header + 20, 0x11);
+  adpcm_write16(header + 22, pcm.channels);
+  adpcm_write32(header + 24, pcm.sample_rate);
+  adpcm_write32(header + 28, (uint32_t)((uint64_t)pcm.sample_rate * block_align / per_block));
+  adpcm_write16(header + 32, (uint16_t)block_align);
+  adpcm_write16(header + 34, 4);
+  adpcm_write16(header + 36, 2);
+  adpcm_write16(header + 38, (uint16_t)per_block);
+  memcpy(header + 40, "fact", 4);
+  adpcm_write32(header + 44, 4);
+  adpcm_write32(header + 48, pcm.frames);
+  memcpy(header + 52, "data", 4);
+  adpcm_write32(header + 56, data_len);
+
+  FILE *f = fopen(out_path, "wb");
+  if (f == NULL) {
+    free(data);
+    return "could not open output file";
+  }
+
+  size_t written = fwrite(header, 1, sizeof(header), f);
+  written += fwrite(data, 1, data_len, f);
+  fclose(f);
+  free(data);
+
+  if (written != sizeof(header) + data_len) return "could not write output file";
+
+  *out_bytes = (uint32_t)written;
+  return NULL;
+}
+
+// Jobs are "input\toutput" lines. Workers claim the next job with an atomic
+// counter until none are left.
+typedef struct {
+  char **inputs;
+  char **outputs;
+  uint32_t count;
+  uint32_t block_size;
+  uint32_t next;
+  uint32_t failures;
+} adpcm_jobs;
+
+static void *adpcm_worker(void *arg) {
+  adpcm_jobs *jobs = (adpcm_jobs*)arg;
+  for (;;) {
+    uint32_t i = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED);
+    if (i >= jobs->count) break;
+
+    uint32_t in_bytes = 0;
+    uint32_t out_bytes = 0;
+    const char *err = adpcm_encode_file(jobs->inputs[i], jobs->outputs[i], jobs->block_size, &in_bytes, &out_bytes);
+    if (err != NULL) {
+      fprintf(stderr, "%s: %s\n", jobs->inputs[i], err);
+      __atomic_fetch_add(&jobs->failures, 1, __ATOMIC_RELAXED);
+    } else {
+      printf("%s -> %s (%u -> %u bytes)\n", jobs->inputs[i], jobs->outputs[i], in_bytes, out_bytes);
+    }
+  }
+  return NULL;
+}
+
+// Encode every job, returning the number which failed.
+static uint32_t adpcm_run_jobs(char *list, uint32_t block_size, uint32_t threads) {
+  adpcm_jobs jobs = {NULL, NULL, 0, block_size, 0, 0};
+
+  uint32_t lines = 0;
+  for (char *c = list; *c; c++) {
+    if (*c == '\n') lines++;
+  }
+  jobs.inputs = malloc(sizeof(char*) * (lines + 1));
+  jobs.outputs = malloc(sizeof(char*) * (lines + 1));
+
+  // Split the list in place into NUL terminated input/output paths.
+  char *line = list;
+  while (line != NULL && *line) {
+    char *end = strchr(line, '\n');
+    if (end != NULL) *end = '\0';
+    char *tab = strchr(line, '\t');
+    if (tab != NULL) {
+      *tab = '\0';
+      jobs.inputs[jobs.count] = line;
+      jobs.outputs[jobs.count] = tab + 1;
+      jobs.count++;
+    }
+    line = end != NULL ? end + 1 : NULL;
+  }
+
+#ifdef _WIN32
+  (void)threads;
+  adpcm_worker(&jobs);
+#else
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (uint32_t)cpus : 1;
+  }
+  if (threads > jobs.count) threads = jobs.count;
+
+  pthread_t *workers = malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+  uint32_t started = 0;
+  for (uint32_t i = 1; i < threads; i++) {
+    if (pthread_create(&workers[started], NULL, adpcm_worker, &jobs) == 0) started++;
+  }
+  // The calling thread works too, so encoding still happens if no workers could start.
+  adpcm_worker(&jobs);
+  for (uint32_t i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+#endif
+
+  free(jobs.inputs);
+  free(jobs.outputs);
+  return jobs.failures;
+}
+
+int32_t kk_adpcm__encode_files(kk_string_t jobs, int32_t block_size, int32_t threads, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(jobs, &len, ctx);
+  char *list = malloc((size_t)len + 1);
+  memcpy(list, cstr, (size_t)len);
+  list[len] = '\0';
+  kk_string_drop(jobs, ctx);
+
+  uint32_t failures = adpcm_run_jobs(list, block_size > 0 ? (uint32_t)block_size : 512, threads > 0 ? (uint32_t)threads : 0);
+  free(list);
+  return (int32_t)failures;
+}
@@ -0,0 +1 @@
+int32_t kk_adpcm__encode_files(kk_string_t, int32_t, int32_t, kk_context_t*);
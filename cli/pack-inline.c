@@ -0,0 +1,385 @@
+/*==============================================================================
+ Pack file builder
+ -------------------------------
+ Writes the pack format read by db_pack.h: a header, an open addressing hash
+ table of entry indices, the entries, a name table, and then every payload
+ starting on an aligned offset. The layout and hash must match db_pack.h and
+ db_pack.c exactly.
+
+ With compression enabled each file is split into 64 KiB blocks which are
+ compressed to the LZ4 block format (decoded by db_lz4.c). Blocks which don't
+ shrink are stored raw, and files which don't shrink overall are stored
+ uncompressed.
+ =============================================================================*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_VERSION 1
+#define PACK_EMPTY_BUCKET 0xFFFFFFFF
+#define PACK_HEADER_SIZE 32
+#define PACK_ENTRY_SIZE 24
+#define PACK_BLOCK_SIZE 65536
+#define PACK_BLOCK_RAW 0x80000000
+
+#define LZ4_HASH_BITS 12
+#define LZ4_MIN_MATCH 4
+// LZ4 requires the last match to start at least 12 bytes before the end of a
+// block, and the last 5 bytes to be literals.
+#define LZ4_MF_LIMIT 12
+#define LZ4_LAST_LITERALS 5
+
+typedef struct {
+  const char *name;
+  const char *path;
+  uint64_t hash;
+  uint32_t offset;
+  uint32_t size;
+  uint32_t name_offset;
+  // Compressed payload, NULL if the file is stored as is.
+  uint8_t *payload;
+  uint32_t compressed_size;
+} pack_job;
+
+static uint64_t pack_hash_name(const char *name) {
+  uint64_t h = 0xCBF29CE484222325ull;
+  for (const uint8_t *c = (const uint8_t*)name; *c != '\0'; c++) {
+    h ^= *c;
+    h *= 0x100000001B3ull;
+  }
+  return h;
+}
+
+static void pack_put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static void pack_put64(uint8_t *p, uint64_t v) {
+  pack_put32(p, (uint32_t)v);
+  pack_put32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t lz4_read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static uint8_t *lz4_write_length(uint8_t *op, uint32_t len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+static uint8_t *lz4_write_sequence(uint8_t *op, const uint8_t *literals, uint32_t lit_len, uint32_t offset, uint32_t match_len) {
+  uint8_t *token = op++;
+  *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+  if (lit_len >= 15) op = lz4_write_length(op, lit_len - 15);
+  memcpy(op, literals, lit_len);
+  op += lit_len;
+
+  if (match_len == 0) return op;
+
+  *op++ = (uint8_t)offset;
+  *op++ = (uint8_t)(offset >> 8);
+  uint32_t ml = match_len - LZ4_MIN_MATCH;
+  *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+  if (ml >= 15) op = lz4_write_length(op, ml - 15);
+  return op;
+}
+
+// Greedy single-probe LZ4 block compressor. dst must hold len + len / 255 + 16
+// bytes. Returns the compressed size.
+static uint32_t lz4_compress_block(const uint8_t *src, uint32_t len, uint8_t *dst) {
+  int32_t table[1 << LZ4_HASH_BITS];
+  memset(table, 0xFF, sizeof(table));
+
+  uint8_t *op = dst;
+  uint32_t anchor = 0;
+  uint32_t ip = 0;
+  uint32_t misses = 0;
+
+  if (len > LZ4_MF_LIMIT) {
+    uint32_t limit = len - LZ4_MF_LIMIT;
+    uint32_t match_limit = len - LZ4_LAST_LITERALS;
+
+    while (ip < limit) {
+      uint32_t seq = lz4_read32(src + ip);
+      uint32_t h = (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+      int32_t ref = table[h];
+      table[h] = (int32_t)ip;
+
+      if (ref < 0 || ip - (uint32_t)ref > 65535 || lz4_read32(src + ref) != seq) {
+        // Step further the longer nothing matches, incompressible data is skipped quickly.
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      uint32_t start = ip;
+      uint32_t match = (uint32_t)ref;
+      while (start > anchor && match > 0 && src[start - 1] == src[match - 1]) {
+        start--;
+        match--;
+      }
+
+      uint32_t end = ip + LZ4_MIN_MATCH;
+      while (end < match_limit && src[end] == src[match + (end - start)]) end++;
+
+      op = lz4_write_sequence(op, src + anchor, start - anchor, start - match, end - start);
+      ip = end;
+      anchor = end;
+
+      if (ip - 2 < limit) {
+        table[(lz4_read32(src + ip - 2) * 2654435761u) >> (32 - LZ4_HASH_BITS)] = (int32_t)(ip - 2);
+      }
+    }
+  }
+
+  return (uint32_t)(lz4_write_sequence(op, src + anchor, len - anchor, 0, 0) - dst);
+}
+
+// Compress a whole file into the block framing read by pack_extract. Returns
+// the payload, or NULL if compression doesn't make the file smaller.
+static uint8_t *pack_compress(const uint8_t *data, uint32_t len, uint32_t *out_len) {
+  uint32_t blocks = (len + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE;
+  uint8_t *payload = malloc((size_t)len + blocks * 4 + 16);
+  uint8_t *scratch = malloc(PACK_BLOCK_SIZE + PACK_BLOCK_SIZE / 255 + 16);
+  uint32_t size = 0;
+
+  for (uint32_t pos = 0; pos < len; pos += PACK_BLOCK_SIZE) {
+    uint32_t block_len = len - pos < PACK_BLOCK_SIZE ? len - pos : PACK_BLOCK_SIZE;
+    uint32_t compressed = lz4_compress_block(data + pos, block_len, scratch);
+
+    uint32_t header = compressed < block_len ? compressed : (block_len | PACK_BLOCK_RAW);
+    const uint8_t *stored = compressed < block_len ? scratch : data + pos;
+    uint32_t stored_len = header & ~PACK_BLOCK_RAW;
+
+    if (size + 4 + stored_len >= len) {
+      free(payload);
+      free(scratch);
+      return NULL;
+    }
+
+    pack_put32(payload + size, header);
+    memcpy(payload + size + 4, stored, stored_len);
+    size += 4 + stored_len;
+  }
+
+  free(scratch);
+  *out_len = size;
+  return payload;
+}
+
+// Read a whole file into memory.
+static uint8_t *pack_read_file(const char *path, uint32_t size) {
+  FILE *in = fopen(path, "rb");
+  if (in == NULL) return NULL;
+  uint8_t *data = malloc(size > 0 ? size : 1);
+  if (fread(data, 1, size, in) != size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(in);
+  return data;
+}
+
+static int pack_compare_jobs(const void *a, const void *b) {
+  return strcmp(((const pack_job*)a)->name, ((const pack_job*)b)->name);
+}
+
+static int pack_write_zeros(FILE *out, uint32_t count) {
+  static const uint8_t zeros[256] = {0};
+  while (count > 0) {
+    uint32_t n = count < sizeof(zeros) ? count : (uint32_t)sizeof(zeros);
+    if (fwrite(zeros, 1, n, out) != n) return 0;
+    count -= n;
+  }
+  return 1;
+}
+
+// Error message naming the file which could not be read.
+static const char *pack_read_error(const char *path) {
+  static char message[512];
+  snprintf(message, sizeof(message), "could not read %s", path);
+  return message;
+}
+
+static uint32_t pack_align_up(uint64_t value, uint32_t alignment) {
+  return (uint32_t)((value + alignment - 1) / alignment * alignment);
+}
+
+// Build the pack, returning an error message or NULL on success.
+static const char *pack_build(pack_job *jobs, uint32_t count, const char *output, uint32_t alignment, int compress) {
+  // Sorted so the same directory always produces the same pack.
+  qsort(jobs, count, sizeof(pack_job), pack_compare_jobs);
+
+  uint32_t bucket_count = 1;
+  while (bucket_count < count * 2 || bucket_count <= count) bucket_count <<= 1;
+
+  uint32_t names_size = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    jobs[i].hash = pack_hash_name(jobs[i].name);
+    jobs[i].name_offset = names_size;
+    names_size += (uint32_t)strlen(jobs[i].name) + 1;
+
+    FILE *in = fopen(jobs[i].path, "rb");
+    if (in == NULL) return pack_read_error(jobs[i].path);
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fclose(in);
+    if (size < 0 || (uint64_t)size > 0xFFFFFFFFull) return pack_read_error(jobs[i].path);
+    jobs[i].size = (uint32_t)size;
+
+    if (compress && size > 0) {
+      uint8_t *data = pack_read_file(jobs[i].path, jobs[i].size);
+      if (data == NULL) return pack_read_error(jobs[i].path);
+      jobs[i].payload = pack_compress(data, jobs[i].size, &jobs[i].compressed_size);
+      free(data);
+    }
+  }
+
+  uint32_t index_size = bucket_count * 4 + count * PACK_ENTRY_SIZE + names_size;
+  uint64_t offset = pack_align_up(PACK_HEADER_SIZE + (uint64_t)index_size, alignment);
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t stored_size = jobs[i].payload != NULL ? jobs[i].compressed_size : jobs[i].size;
+    if (offset + stored_size > 0xFFFFFFFFull) return "pack would be larger than 4 GiB";
+    jobs[i].offset = (uint32_t)offset;
+    offset = pack_align_up(offset + stored_size, alignment);
+  }
+
+  uint8_t *index = calloc(1, PACK_HEADER_SIZE + (size_t)index_size);
+  uint8_t *header = index;
+  memcpy(header, "DBPK", 4);
+  pack_put32(header + 4, PACK_VERSION);
+  pack_put32(header + 8, count);
+  pack_put32(header + 12, bucket_count);
+  pack_put32(header + 16, names_size);
+  pack_put32(header + 20, alignment);
+  pack_put32(header + 24, index_size);
+
+  uint8_t *buckets = index + PACK_HEADER_SIZE;
+  uint8_t *entries = buckets + bucket_count * 4;
+  char *names = (char*)(entries + count * PACK_ENTRY_SIZE);
+  memset(buckets, 0xFF, bucket_count * 4);
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t *entry = entries + i * PACK_ENTRY_SIZE;
+    pack_put64(entry, jobs[i].hash);
+    pack_put32(entry + 8, jobs[i].offset);
+    pack_put32(entry + 12, jobs[i].size);
+    pack_put32(entry + 16, jobs[i].name_offset);
+    pack_put32(entry + 20, jobs[i].payload != NULL ? jobs[i].compressed_size : 0);
+    strcpy(names + jobs[i].name_offset, jobs[i].name);
+
+    uint32_t b = (uint32_t)jobs[i].hash & (bucket_count - 1);
+    while (buckets[b * 4] != 0xFF || buckets[b * 4 + 1] != 0xFF || buckets[b * 4 + 2] != 0xFF || buckets[b * 4 + 3] != 0xFF) {
+      b = (b + 1) & (bucket_count - 1);
+    }
+    pack_put32(buckets + b * 4, i);
+  }
+
+  FILE *out = fopen(output, "wb");
+  if (out == NULL) {
+    free(index);
+    return "could not open output file";
+  }
+
+  const char *err = NULL;
+  uint64_t written = PACK_HEADER_SIZE + (uint64_t)index_size;
+  if (fwrite(index, 1, (size_t)written, out) != written) err = "write failed";
+  free(index);
+
+  uint8_t *copy = malloc(1 << 16);
+  for (uint32_t i = 0; i < count && err == NULL; i++) {
+    if (!pack_write_zeros(out, (uint32_t)(jobs[i].offset - written))) {
+      err = "write failed";
+      break;
+    }
+    written = jobs[i].offset;
+
+    if (jobs[i].payload != NULL) {
+      if (fwrite(jobs[i].payload, 1, jobs[i].compressed_size, out) != jobs[i].compressed_size) err = "write failed";
+      written += jobs[i].compressed_size;
+      printf("%s (%u bytes compressed to %u at %u)\n", jobs[i].name, jobs[i].size, jobs[i].compressed_size, jobs[i].offset);
+      continue;
+    }
+
+    FILE *in = fopen(jobs[i].path, "rb");
+    if (in == NULL) {
+      err = pack_read_error(jobs[i].path);
+      break;
+    }
+    uint32_t remaining = jobs[i].size;
+    while (remaining > 0) {
+      size_t n = fread(copy, 1, remaining < (1u << 16) ? remaining : (1u << 16), in);
+      if (n == 0 || fwrite(copy, 1, n, out) != n) {
+        err = pack_read_error(jobs[i].path);
+        break;
+      }
+      remaining -= (uint32_t)n;
+    }
+    fclose(in);
+    written += jobs[i].size;
+    printf("%s (%u bytes at %u)\n", jobs[i].name, jobs[i].size, jobs[i].offset);
+  }
+  free(copy);
+
+  fclose(out);
+  return err;
+}
+
+int32_t kk_pack__build_pack(kk_string_t jobs, kk_string_t output, int32_t alignment, uint8_t compress, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(jobs, &len, ctx);
+  char *list = malloc((size_t)len + 1);
+  memcpy(list, cstr, (size_t)len);
+  list[len] = '\0';
+  kk_string_drop(jobs, ctx);
+
+  kk_ssize_t output_len;
+  const uint8_t *output_cstr = kk_string_buf_borrow(output, &output_len, ctx);
+  char *output_path = malloc((size_t)output_len + 1);
+  memcpy(output_path, output_cstr, (size_t)output_len);
+  output_path[output_len] = '\0';
+  kk_string_drop(output, ctx);
+
+  uint32_t lines = 0;
+  for (char *c = list; *c; c++) {
+    if (*c == '\n') lines++;
+  }
+  pack_job *pack_jobs = calloc(lines + 1, sizeof(pack_job));
+  uint32_t count = 0;
+
+  // Split the list in place into NUL terminated name/path pairs.
+  char *line = list;
+  while (line != NULL && *line) {
+    char *end = strchr(line, '\n');
+    if (end != NULL) *end = '\0';
+    char *tab = strchr(line, '\t');
+    if (tab != NULL) {
+      *tab = '\0';
+      pack_jobs[count].name = line;
+      pack_jobs[count].path = tab + 1;
+      count++;
+    }
+    line = end != NULL ? end + 1 : NULL;
+  }
+
+  const char *err = pack_build(pack_jobs, count, output_path, alignment > 0 ? (uint32_t)alignment : 2048, compress);
+  if (err != NULL) fprintf(stderr, "%s: %s\n", output_path, err);
+
+  for (uint32_t i = 0; i < count; i++) {
+    free(pack_jobs[i].payload);
+  }
+  free(pack_jobs);
+  free(list);
+  free(output_path);
+  return err != NULL ? 1 : 0;
+}
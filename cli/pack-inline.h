@@ -0,0 +1 @@
+int32_t kk_pack__build_pack(kk_string_t, kk_string_t, int32_t, uint8_t, kk_context_t*);
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_math.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BROADPHASE_INVALID_ID 0xFFFFFFFF
+
+/// @brief A pair of overlapping entities reported by broadphase_findPairs
+typedef struct
+{
+    uint32_t a;
+    uint32_t b;
+} broadphase_Pair;
+
+/// @brief A uniform grid spatial hash. Entity data is stored as parallel arrays indexed by entity ID.
+/// All storage is allocated up front by broadphase_init, no allocations happen afterwards.
+typedef struct
+{
+    /// @brief Edge length of each grid cell
+    float cellSize;
+    float invCellSize;
+
+    /// @brief Maximum number of entities
+    uint32_t capacity;
+
+    /// @brief Number of live entities
+    uint32_t count;
+
+    /// @brief Entity bounds, indexed by entity ID
+    float *minX;
+    float *minY;
+    float *minZ;
+    float *maxX;
+    float *maxY;
+    float *maxZ;
+
+    /// @brief User data passed to broadphase_insert, indexed by entity ID
+    uint32_t *userData;
+
+    // Range of cells each entity currently occupies
+    int32_t *cellMinX;
+    int32_t *cellMinY;
+    int32_t *cellMinZ;
+    int32_t *cellMaxX;
+    int32_t *cellMaxY;
+    int32_t *cellMaxZ;
+
+    // Entity free list (linked through nextFree), query de-duplication stamps
+    uint32_t *nextFree;
+    uint32_t *queryStamp;
+    uint32_t freeHead;
+    uint32_t currentStamp;
+
+    // Hash buckets, each the head of a list of cell entries
+    uint32_t bucketMask;
+    uint32_t *buckets;
+
+    // Cell entries, one per (entity, occupied cell)
+    uint32_t entryCapacity;
+    uint32_t entryFreeHead;
+    uint32_t *entryEntity;
+    uint32_t *entryNext;
+    int32_t *entryCellX;
+    int32_t *entryCellY;
+    int32_t *entryCellZ;
+} broadphase_Grid;
+
+/// @brief Initialize a grid, allocating all of its storage
+/// @param grid The grid to initialize
+/// @param cellSize Edge length of each grid cell (should be around the size of a typical entity)
+/// @param maxEntities Maximum number of entities which may be inserted
+/// @param maxCellEntries Maximum number of (entity, cell) entries. Entities overlapping several cells use one entry per cell
+/// @return True if the grid was initialized, false if allocation failed
+uint8_t broadphase_init(broadphase_Grid *grid, float cellSize, uint32_t maxEntities, uint32_t maxCellEntries);
+
+/// @brief Release the storage allocated by broadphase_init
+/// @param grid The grid to destroy
+void broadphase_destroy(broadphase_Grid *grid);
+
+/// @brief Remove all entities from the grid
+/// @param grid The grid to clear
+void broadphase_clear(broadphase_Grid *grid);
+
+/// @brief Insert an entity into the grid
+/// @param grid The grid
+/// @param min The minimum corner of the entity bounds
+/// @param max The maximum corner of the entity bounds
+/// @param userData Value stored alongside the entity
+/// @return The ID of the new entity, or BROADPHASE_INVALID_ID if the grid is full or the bounds are invalid (not finite,
+/// inverted, or covering more cells than maxCellEntries)
+uint32_t broadphase_insert(broadphase_Grid *grid, Vec3 min, Vec3 max, uint32_t userData);
+
+/// @brief Update the bounds of an entity. Cheap if the entity doesn't move to a different set of cells
+/// @param grid The grid
+/// @param id The entity ID returned by broadphase_insert
+/// @param min The new minimum corner of the entity bounds
+/// @param max The new maximum corner of the entity bounds
+/// @return True if the entity was updated, false if id isn't a live entity, the bounds are invalid as for broadphase_insert
+/// (the entity is left unchanged), or the grid ran out of cell entries (the entity is removed in that case)
+uint8_t broadphase_update(broadphase_Grid *grid, uint32_t id, Vec3 min, Vec3 max);
+
+/// @brief Remove an entity from the grid
+/// @param grid The grid
+/// @param id The entity ID returned by broadphase_insert
+void broadphase_remove(broadphase_Grid *grid, uint32_t id);
+
+/// @brief Find all entities whose bounds overlap the given box
+/// @param grid The grid
+/// @param min The minimum corner of the box
+/// @param max The maximum corner of the box
+/// @param outIds Array to write overlapping entity IDs to
+/// @param maxIds Length of the outIds array
+/// @return The number of IDs written to outIds
+uint32_t broadphase_queryAABB(broadphase_Grid *grid, Vec3 min, Vec3 max, uint32_t *outIds, uint32_t maxIds);
+
+/// @brief Find all entities whose bounds overlap the given sphere
+/// @param grid The grid
+/// @param center The center of the sphere
+/// @param radius The radius of the sphere
+/// @param outIds Array to write overlapping entity IDs to
+/// @param maxIds Length of the outIds array
+/// @return The number of IDs written to outIds
+uint32_t broadphase_queryRadius(broadphase_Grid *grid, Vec3 center, float radius, uint32_t *outIds, uint32_t maxIds);
+
+/// @brief Find all pairs of entities with overlapping bounds. Each pair is reported once
+/// @param grid The grid
+/// @param outPairs Array to write overlapping pairs to
+/// @param maxPairs Length of the outPairs array
+/// @return The number of pairs written to outPairs
+uint32_t broadphase_findPairs(broadphase_Grid *grid, broadphase_Pair *outPairs, uint32_t maxPairs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// @brief Maximum length of a cached directory path, including the terminator
+#define DIRCACHE_PATH_LEN 64
+
+#define DIRCACHE_FLAG_DIRECTORY 1
+
+/// @brief A cached directory entry
+typedef struct
+{
+    /// @brief Offset of the NUL terminated name in the cache's name buffer, see dircache_name
+    uint32_t nameOffset;
+    /// @brief The size of the file in bytes (0 if this is a directory)
+    uint32_t size;
+    /// @brief A timestamp representing the time the file or directory was last modified
+    uint64_t modified;
+    uint16_t nameLen;
+    /// @brief DIRCACHE_FLAG_* bits
+    uint16_t flags;
+} dircache_Entry;
+
+/// @brief The listing of a directory, enumerated once + sorted by name
+typedef struct
+{
+    char path[DIRCACHE_PATH_LEN];
+    /// @brief The storage device the directory is on ("cd", "ma" or "mb")
+    char device[4];
+    /// @brief False until the directory has been enumerated, and again once it was invalidated
+    uint8_t valid;
+
+    dircache_Entry *entries;
+    uint32_t count;
+    uint32_t entriesCap;
+
+    /// @brief The entry names, back to back
+    char *names;
+    uint32_t namesLen;
+    uint32_t namesCap;
+} dircache_Dir;
+
+/// @brief Initialize a directory cache + enumerate the directory
+/// @param dir The cache to initialize
+/// @param path Path to the directory, starting with the device (e.g. "/ma/saves")
+/// @return True if the directory was enumerated, false otherwise. The cache is usable either way
+uint8_t dircache_open(dircache_Dir *dir, const char *path);
+
+/// @brief Free the cached listing
+/// @param dir The cache
+void dircache_free(dircache_Dir *dir);
+
+/// @brief Mark the listing as stale, e.g. after creating or deleting a file in the directory
+/// @param dir The cache
+void dircache_invalidate(dircache_Dir *dir);
+
+/// @brief Make sure the listing is current. Invalidates it if the device is gone + re-enumerates a stale listing
+/// if the device is present. Costs a single host call when the listing is already current. Call it every frame
+/// a listing is shown so an eject is noticed even if the device is reinserted later
+/// @param dir The cache
+/// @return True if the listing is valid, false otherwise
+uint8_t dircache_update(dircache_Dir *dir);
+
+/// @brief Get the name of a cached entry
+/// @param dir The cache
+/// @param entry An entry of the cache
+/// @return The NUL terminated name
+const char *dircache_name(const dircache_Dir *dir, const dircache_Entry *entry);
+
+/// @brief Find an entry by name with a binary search
+/// @param dir The cache
+/// @param name The name to look up
+/// @return The entry, or NULL if there is no entry with that name
+const dircache_Entry *dircache_find(const dircache_Dir *dir, const char *name);
+
+/// @brief Find the entries whose name starts with a prefix. They are adjacent in the sorted listing
+/// @param dir The cache
+/// @param prefix The prefix, "" matches every entry
+/// @param outCount Receives the number of matching entries
+/// @return Index of the first matching entry in dir->entries
+uint32_t dircache_findPrefix(const dircache_Dir *dir, const char *prefix, uint32_t *outCount);
+
+#ifdef __cplusplus
+}
+#endif
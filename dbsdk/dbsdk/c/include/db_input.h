@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_gamepad.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define INPUT_PORTS 4
+
+/// @brief Number of frames of input kept per port, a power of two
+#define INPUT_HISTORY 32
+
+/// @brief Connection state is re-checked every this many input_readPads calls
+#define INPUT_CONNECT_INTERVAL 30
+
+/// @brief Default radial deadzone of both sticks
+#define INPUT_DEFAULT_DEADZONE 4000
+
+/// @brief Read all connected gamepads without advancing the history. The next input_update uses this read instead of
+/// reading the gamepads again, so code which only needs the current state can share a frame's read with input_update
+void input_readPads();
+
+/// @brief Read all connected gamepads (unless input_readPads already has since the last call) + advance the history by
+/// a frame. Call once per frame
+void input_update();
+
+/// @brief Set the radial deadzone of a port's sticks. Positions inside it read as 0, positions outside are rescaled
+/// so the stick still covers the full range
+/// @param port The port (0 to 3)
+/// @param deadzone Deadzone radius, between 0 and 32766
+void input_setDeadzone(uint32_t port, int16_t deadzone);
+
+/// @brief Check if a gamepad was connected to a port as of the last connection check
+/// @param port The port (0 to 3)
+/// @return True if a gamepad is connected, false otherwise
+uint8_t input_isConnected(uint32_t port);
+
+/// @brief Get the buttons held down this frame
+/// @param port The port (0 to 3)
+/// @return Bitmask of GAMEPAD_BTN_* bits
+uint16_t input_held(uint32_t port);
+
+/// @brief Get the buttons that went down this frame
+/// @param port The port (0 to 3)
+/// @return Bitmask of GAMEPAD_BTN_* bits
+uint16_t input_pressed(uint32_t port);
+
+/// @brief Get the buttons that were let go this frame
+/// @param port The port (0 to 3)
+/// @return Bitmask of GAMEPAD_BTN_* bits
+uint16_t input_released(uint32_t port);
+
+/// @brief Get the buttons that went down during a range of recent frames, e.g. to buffer a jump pressed just before landing
+/// or to find the first press of a double tap
+/// @param port The port (0 to 3)
+/// @param mask The buttons to check
+/// @param framesAgo The most recent frame to check, 0 for this frame or 1 to only look at earlier frames
+/// @param frames Number of frames to check, going back from framesAgo. framesAgo + frames is at most INPUT_HISTORY - 1
+/// @return The buttons of mask pressed within the frames
+uint16_t input_pressedWithin(uint32_t port, uint16_t mask, uint32_t framesAgo, uint32_t frames);
+
+/// @brief Get the state of a port as of the last input_readPads or input_update, without deadzones applied
+/// @param port The port (0 to 3)
+/// @return The state, or NULL if port is out of range. Valid until the next input_readPads or input_update
+const gamepad_State *input_padState(uint32_t port);
+
+/// @brief Get the state of a port in an earlier frame, with deadzones applied
+/// @param port The port (0 to 3)
+/// @param framesAgo 0 for this frame, up to INPUT_HISTORY - 1
+/// @return The state, or NULL if port or framesAgo is out of range. Valid until the next input_update
+const gamepad_State *input_state(uint32_t port, uint32_t framesAgo);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_sounddriver.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// @brief Maximum number of load requests which may be pending at once
+#define LOADER_MAX_REQUESTS 32
+
+/// @brief Maximum length of a requested path, including the terminator
+#define LOADER_PATH_LEN 128
+
+/// @brief Number of bytes read per loader_update call unless changed with loader_setBudget
+#define LOADER_DEFAULT_FRAME_BYTES (64 * 1024)
+
+/// @brief A handle which never refers to a request
+#define LOADER_INVALID_HANDLE 0xFFFFFFFF
+
+#define LOADER_STATE_INVALID 0
+#define LOADER_STATE_QUEUED 1
+#define LOADER_STATE_LOADING 2
+#define LOADER_STATE_DONE 3
+#define LOADER_STATE_FAILED 4
+
+/// @brief Deliver the file contents to the callback
+#define LOADER_UPLOAD_NONE 0
+/// @brief Upload the file contents to a texture, then free them
+#define LOADER_UPLOAD_TEXTURE 1
+/// @brief Load the file contents as a WAV sample, then free them
+#define LOADER_UPLOAD_SAMPLE 2
+
+/// @brief Generation-checked handle to a load request. Handles to completed or cancelled requests are ignored
+typedef uint32_t loader_handle;
+
+/// @brief The outcome of a load request, passed to its callback
+typedef struct
+{
+    /// @brief LOADER_STATE_DONE or LOADER_STATE_FAILED
+    uint8_t state;
+    /// @brief The file contents for LOADER_UPLOAD_NONE requests, owned by the callback + released with free. NULL otherwise
+    uint8_t *data;
+    /// @brief Size of the file in bytes
+    uint32_t size;
+    /// @brief The texture for LOADER_UPLOAD_TEXTURE requests
+    uint32_t texture;
+    /// @brief The sample for LOADER_UPLOAD_SAMPLE requests
+    sound_sample sample;
+} loader_Result;
+
+/// @brief Called from loader_update when a request completes or fails. May queue or cancel other requests
+typedef void (*loader_Callback)(loader_handle handle, loader_Result *result, void *userData);
+
+/// @brief Set how much loading loader_update may do per call
+/// @param frameBytes Maximum number of bytes to read per call
+/// @param frameMs Maximum time to spend reading per call in milliseconds (measured with audio_getTime), or 0 to only limit by bytes
+void loader_setBudget(uint32_t frameBytes, float frameMs);
+
+/// @brief Queue a file to be read into memory
+/// @param path Path to the file
+/// @param priority Requests with a higher priority are read first, equal priorities are read in the order they were queued
+/// @param callback Called with the file contents once the file has been read, may be NULL
+/// @param userData Passed to the callback
+/// @return A handle to the request, or LOADER_INVALID_HANDLE if too many requests are pending
+loader_handle loader_load(const char *path, uint8_t priority, loader_Callback callback, void *userData);
+
+/// @brief Queue a file to be read + uploaded to a new texture
+/// @param path Path to the file, containing texture data of the given format + size
+/// @param priority Requests with a higher priority are read first
+/// @param format Texture format (one of the VDP_TEXFMT_* values)
+/// @param width Texture width
+/// @param height Texture height
+/// @param callback Called with the texture once it has been uploaded, may be NULL
+/// @param userData Passed to the callback
+/// @return A handle to the request, or LOADER_INVALID_HANDLE if too many requests are pending
+loader_handle loader_loadTexture(const char *path, uint8_t priority, uint32_t format, uint32_t width, uint32_t height, loader_Callback callback, void *userData);
+
+/// @brief Queue a WAV file to be read + loaded as a sample
+/// @param path Path to the WAV file
+/// @param priority Requests with a higher priority are read first
+/// @param stereoMode How stereo files are loaded (SOUND_STEREO_DOWNMIX or SOUND_STEREO_SPLIT)
+/// @param callback Called with the sample once it has been loaded, may be NULL
+/// @param userData Passed to the callback
+/// @return A handle to the request, or LOADER_INVALID_HANDLE if too many requests are pending
+loader_handle loader_loadSample(const char *path, uint8_t priority, uint8_t stereoMode, loader_Callback callback, void *userData);
+
+/// @brief Cancel a pending request. Its callback is not called
+/// @param handle The request
+void loader_cancel(loader_handle handle);
+
+/// @brief Get the state of a request
+/// @param handle The request
+/// @return LOADER_STATE_QUEUED or LOADER_STATE_LOADING while pending, LOADER_STATE_INVALID once completed or cancelled
+uint8_t loader_getState(loader_handle handle);
+
+/// @brief Get how much of a request has been read
+/// @param handle The request
+/// @return The fraction of the file read so far, 0 if it hasn't started
+float loader_progress(loader_handle handle);
+
+/// @brief Get the number of pending requests
+/// @return The number of requests queued or loading
+uint32_t loader_pendingCount();
+
+/// @brief Read the next part of the pending requests within the frame budget + run the callbacks of completed
+/// requests. Call once per frame, e.g. from the vsync handler
+void loader_update();
+
+#ifdef __cplusplus
+}
+#endif
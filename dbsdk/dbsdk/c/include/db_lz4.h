@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// @brief Decompress an LZ4 block (the raw block format, without the LZ4 frame header) into a caller-supplied buffer.
+/// Makes no allocations, and every read + write is bounds checked so corrupt input can't overrun either buffer
+/// @param src The compressed block
+/// @param srcLen Length of the compressed block
+/// @param dst Buffer to decompress into
+/// @param dstCap Size of the destination buffer
+/// @return The number of bytes written to dst, or -1 if the block is malformed or doesn't fit in dst
+int32_t lz4_decompressBlock(const uint8_t *src, uint32_t srcLen, uint8_t *dst, uint32_t dstCap);
+
+#ifdef __cplusplus
+}
+#endif
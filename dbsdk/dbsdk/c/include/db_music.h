@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// @brief Number of soundfont bytes read per music_update call
+#ifndef MUSIC_LOAD_CHUNK_SIZE
+#define MUSIC_LOAD_CHUNK_SIZE (256 * 1024)
+#endif
+
+/// @brief Maximum number of MIDI files kept in memory by music_playMidi
+#ifndef MUSIC_MAX_CACHED_MIDI
+#define MUSIC_MAX_CACHED_MIDI 16
+#endif
+
+#define MUSIC_STATE_IDLE 0
+#define MUSIC_STATE_LOADING 1
+#define MUSIC_STATE_READY 2
+#define MUSIC_STATE_ERROR 3
+
+/// @brief Begin loading a soundfont in the background. The file is read in MUSIC_LOAD_CHUNK_SIZE chunks by music_update,
+/// and the synth is initialized once the whole file has been read. If a synth is already initialized it keeps playing
+/// until the new soundfont replaces it, and keeps playing if the new soundfont fails to load (the state returns to
+/// MUSIC_STATE_READY)
+/// @param path Path to the SF2 file
+/// @return True if the file was opened, false otherwise
+uint8_t music_beginLoadSoundfont(const char *path);
+
+/// @brief Continue loading the soundfont. Call once per frame
+void music_update();
+
+/// @brief Get the state of the synth
+/// @return One of the MUSIC_STATE_* enumerations
+uint8_t music_getState();
+
+/// @brief Get how much of the soundfont has been loaded
+/// @return Progress from 0 to 1
+float music_loadProgress();
+
+/// @brief Play a MIDI file. The file is read once + kept in memory, so playing it again doesn't touch the disc.
+/// If the first soundfont is still loading, playback starts as soon as the synth is initialized
+/// @param path Path to the standard MIDI file
+/// @param loop Whether to loop playback
+/// @return False if the file could not be read or playback failed, true otherwise
+uint8_t music_playMidi(const char *path, uint8_t loop);
+
+/// @brief Play MIDI data already in memory. If the first soundfont is still loading, playback starts as soon as the synth is initialized
+/// @param smfData Pointer to the standard MIDI file data. Must remain valid until it has started playing
+/// @param smfDataLen Length of the data
+/// @param loop Whether to loop playback
+/// @return False if playback failed, true otherwise
+uint8_t music_playMidiBytes(void *smfData, uint32_t smfDataLen, uint8_t loop);
+
+/// @brief Set the volume of MIDI playback. Applied once the synth is initialized if the first soundfont is still loading
+/// @param volume The new volume
+void music_setVolume(float volume);
+
+/// @brief Set whether MIDI playback is routed through the global reverb unit. Applied once the synth is initialized if the first soundfont is still loading
+/// @param enabled True to enable reverb
+void music_setReverb(uint8_t enabled);
+
+/// @brief Free all cached MIDI files. Must not be called while a cached file is playing
+void music_clearCache();
+
+#ifdef __cplusplus
+}
+#endif
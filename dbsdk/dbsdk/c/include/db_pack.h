@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_io.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ Pack file layout (all values little endian):
+   pack_Header
+   uint32_t buckets[bucketCount]   entry index per hash bucket, PACK_EMPTY_BUCKET if empty (open addressing, linear probing)
+   pack_Entry entries[entryCount]
+   char names[namesSize]           NUL terminated asset names, '/' separated paths relative to the packed directory
+   payloads                        each starting on a multiple of alignment
+
+ Compressed payloads are a series of blocks, each decompressing to PACK_BLOCK_SIZE bytes (the last may be shorter):
+   uint32_t blockHeader            stored length of the block, with PACK_BLOCK_RAW set if the block is stored uncompressed
+   uint8_t data[length]            LZ4 block (see db_lz4.h) or raw bytes
+*/
+
+#define PACK_MAGIC "DBPK"
+#define PACK_VERSION 1
+
+/// @brief Default payload alignment, the size of a CD sector
+#define PACK_DEFAULT_ALIGNMENT 2048
+
+#define PACK_EMPTY_BUCKET 0xFFFFFFFF
+
+/// @brief Decompressed size of each block of a compressed payload
+#define PACK_BLOCK_SIZE 65536
+
+/// @brief Set in a block header if the block is stored uncompressed
+#define PACK_BLOCK_RAW 0x80000000
+
+/// @brief Size of the scratch buffer pack_extract needs to decompress an asset: a block + the header of the next block
+#define PACK_SCRATCH_SIZE (PACK_BLOCK_SIZE + 4)
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    /// @brief Number of hash buckets, always a power of two
+    uint32_t bucketCount;
+    uint32_t namesSize;
+    uint32_t alignment;
+    /// @brief Size of the buckets, entries + names following the header
+    uint32_t indexSize;
+    uint32_t reserved;
+} pack_Header;
+
+/// @brief An asset in a pack
+typedef struct
+{
+    /// @brief pack_hashName of the asset name
+    uint64_t hash;
+    /// @brief Offset of the payload from the start of the pack
+    uint32_t offset;
+    /// @brief Size of the asset contents
+    uint32_t size;
+    /// @brief Offset of the asset name in the name table
+    uint32_t nameOffset;
+    /// @brief Size of the payload in the pack if it is compressed, 0 if the payload is stored uncompressed
+    uint32_t compressedSize;
+} pack_Entry;
+
+/// @brief An open pack file. The index is kept in memory, so finding an asset makes no host calls
+typedef struct
+{
+    IOFILE *file;
+    pack_Header header;
+    uint8_t *index;
+    const uint32_t *buckets;
+    const pack_Entry *entries;
+    const char *names;
+    /// @brief Current position of the file, so sequential reads skip the seek
+    uint32_t position;
+} pack_File;
+
+/// @brief Hash an asset name (64-bit FNV-1a)
+/// @param name The asset name
+/// @return The hash
+uint64_t pack_hashName(const char *name);
+
+/// @brief Open a pack file + read its index
+/// @param pack The pack to initialize
+/// @param path Path to the pack file
+/// @return True if the pack was opened, false otherwise
+uint8_t pack_open(pack_File *pack, const char *path);
+
+/// @brief Close a pack file + free its index
+/// @param pack The pack
+void pack_close(pack_File *pack);
+
+/// @brief Find an asset by name
+/// @param pack The pack
+/// @param name The asset name, relative to the packed directory with '/' separators (e.g. "sfx/jump.wav")
+/// @return The asset entry, or NULL if the pack doesn't contain it
+const pack_Entry *pack_find(const pack_File *pack, const char *name);
+
+/// @brief Get the name of an asset
+/// @param pack The pack
+/// @param entry The asset entry
+/// @return The asset name, or NULL if the entry's name offset is outside the name table
+const char *pack_entryName(const pack_File *pack, const pack_Entry *entry);
+
+/// @brief Read part of an asset's payload, as it is stored in the pack. Use pack_extract to read compressed assets
+/// @param pack The pack
+/// @param entry The asset entry
+/// @param offset Offset within the asset to start reading at
+/// @param dst Buffer to read into
+/// @param len Number of bytes to read
+/// @return The number of bytes read
+uint32_t pack_read(pack_File *pack, const pack_Entry *entry, uint32_t offset, void *dst, uint32_t len);
+
+/// @brief Read a whole asset into a caller-supplied buffer, decompressing it if needed. Compressed blocks are
+/// decompressed straight into dst (e.g. a texture staging buffer), nothing is allocated
+/// @param pack The pack
+/// @param entry The asset entry
+/// @param dst Buffer to read into, at least entry->size bytes
+/// @param scratch Buffer of at least PACK_SCRATCH_SIZE bytes to read compressed blocks into. May be NULL for uncompressed assets
+/// @return True if the whole asset was read, false otherwise
+uint8_t pack_extract(pack_File *pack, const pack_Entry *entry, void *dst, uint8_t *scratch);
+
+/// @brief Load a whole asset into a newly allocated buffer, decompressing it if needed
+/// @param pack The pack
+/// @param name The asset name
+/// @param outSize If not NULL, receives the size of the asset
+/// @return The asset data, to be released with free, or NULL if the asset couldn't be found or read
+uint8_t *pack_load(pack_File *pack, const char *name, uint32_t *outSize);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_io.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ Save file layout, in SAVE_BLOCK_SIZE blocks:
+   header copy 0                   headerBlocks blocks: save_Header, then a save_BlockInfo per data block
+   header copy 1                   headerBlocks blocks
+   data region 0                   capacity blocks
+   data region 1                   capacity blocks
+
+ Each data block lives in one of the two regions, recorded in its save_BlockInfo. Saving writes changed blocks to the
+ region not holding their current contents, then writes the header to the older header copy. Until that header write
+ completes, the newer copy still describes untouched blocks, so an interrupted save leaves the previous save intact.
+*/
+
+#define SAVE_MAGIC "DBSV"
+#define SAVE_VERSION 1
+
+/// @brief Size of a memory card block, the unit saves are written in
+#define SAVE_BLOCK_SIZE 512
+
+/// @brief Maximum length of a save file path, including the terminator
+#define SAVE_PATH_LEN 64
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    /// @brief Incremented on every save, the valid header copy with the highest sequence is current
+    uint32_t sequence;
+    /// @brief Size of the saved data in bytes
+    uint32_t dataSize;
+    /// @brief Number of data blocks the file was formatted for
+    uint32_t capacity;
+    /// @brief CRC-32 of the header copy (all headerBlocks blocks) with this field set to 0
+    uint32_t headerCrc;
+} save_Header;
+
+typedef struct
+{
+    /// @brief CRC-32 of the block, zero padded to SAVE_BLOCK_SIZE
+    uint32_t crc;
+    /// @brief Data region holding the block, 0 or 1
+    uint32_t region;
+} save_BlockInfo;
+
+/// @brief An open save file. Both header copies are kept in memory, so unchanged blocks are found without reading
+typedef struct
+{
+    char path[SAVE_PATH_LEN];
+    /// @brief Number of data blocks
+    uint32_t capacity;
+    /// @brief Number of blocks in each header copy
+    uint32_t headerBlocks;
+    /// @brief Index of the current header copy
+    uint32_t active;
+    /// @brief The header copies, each headerBlocks * SAVE_BLOCK_SIZE bytes
+    uint8_t *headers[2];
+} save_File;
+
+/// @brief Compute the CRC-32 of a buffer
+/// @param crc CRC of the preceding data, or 0
+/// @param data The data
+/// @param len Length of the data
+/// @return The updated CRC
+uint32_t save_crc32(uint32_t crc, const void *data, uint32_t len);
+
+/// @brief Get the number of blocks to allocate for a save file (e.g. with fs_allocMemoryCard)
+/// @param maxDataSize The largest amount of data that will be saved
+/// @return The number of SAVE_BLOCK_SIZE blocks
+uint32_t save_fileBlocks(uint32_t maxDataSize);
+
+/// @brief Write empty headers to a newly allocated save file
+/// @param save The save to initialize
+/// @param file The file, as returned by fs_allocMemoryCard with save_fileBlocks(maxDataSize) blocks. It is not closed
+/// @param path Path the file is opened with for later saves
+/// @param maxDataSize The largest amount of data that will be saved
+/// @return True if the file was formatted, false otherwise
+uint8_t save_format(save_File *save, IOFILE *file, const char *path, uint32_t maxDataSize);
+
+/// @brief Open an existing save file, reading both header copies
+/// @param save The save to initialize
+/// @param path Path to the save file
+/// @param maxDataSize The maximum data size the file was formatted with
+/// @return True if the file has a valid header, false otherwise
+uint8_t save_open(save_File *save, const char *path, uint32_t maxDataSize);
+
+/// @brief Free the in-memory headers of a save
+/// @param save The save
+void save_close(save_File *save);
+
+/// @brief Get the size of the saved data
+/// @param save The save
+/// @return The size in bytes
+uint32_t save_dataSize(const save_File *save);
+
+/// @brief Read the saved data, verifying the checksum of every block
+/// @param save The save
+/// @param dst Buffer to read into, at least save_dataSize bytes
+/// @param dstLen Size of the buffer
+/// @return True if the data was read + is intact, false otherwise
+uint8_t save_read(save_File *save, void *dst, uint32_t dstLen);
+
+/// @brief Save data, only writing the blocks whose checksum changed since the last save. Changed blocks are written
+/// in contiguous runs, then the header, so a save costs a few host calls no matter how large the file is
+/// @param save The save
+/// @param data The data to save
+/// @param size Size of the data, at most the maxDataSize the file was formatted with
+/// @return The number of data blocks written, or -1 if the save failed (the previous save is then still intact)
+int32_t save_write(save_File *save, const void *data, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
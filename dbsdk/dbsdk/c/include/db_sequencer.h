@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_sounddriver.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SEQUENCER_MAX_CHANNELS 16
+
+/// @brief How far ahead of the current audio time events are scheduled by default, in seconds
+#define SEQUENCER_DEFAULT_LOOKAHEAD 0.1
+
+/// @brief Shortest loop length accepted by sequencer_init, in seconds. Shorter loops are lengthened to this
+#define SEQUENCER_MIN_LOOP_LENGTH 0.01
+
+/// @brief Start a sample on a channel, stopping whatever the channel was playing
+#define SEQUENCER_EVENT_NOTE_ON 0
+/// @brief Stop the sample playing on a channel
+#define SEQUENCER_EVENT_NOTE_OFF 1
+/// @brief Set a voice parameter (AUDIO_VOICEPARAM_VOLUME, AUDIO_VOICEPARAM_PITCH or AUDIO_VOICEPARAM_PAN) on a channel
+#define SEQUENCER_EVENT_PARAM 2
+/// @brief Ramp a voice parameter (AUDIO_VOICEPARAM_VOLUME, AUDIO_VOICEPARAM_PITCH or AUDIO_VOICEPARAM_PAN) on a channel to
+/// a value over a duration
+#define SEQUENCER_EVENT_RAMP 3
+
+/// @brief A single sequencer event
+typedef struct
+{
+    /// @brief Time of the event in seconds, relative to the start of the sequence
+    double time;
+
+    /// @brief One of the SEQUENCER_EVENT_* enumerations
+    uint8_t type;
+
+    /// @brief Channel the event applies to (0 to SEQUENCER_MAX_CHANNELS - 1)
+    uint8_t channel;
+
+    /// @brief NOTE_ON: whether the sample loops until a NOTE_OFF
+    uint8_t loop;
+
+    /// @brief PARAM/RAMP: the voice parameter to change. Events for other parameters are ignored
+    uint8_t param;
+
+    /// @brief NOTE_ON: the volume. PARAM/RAMP: the new parameter value
+    float value;
+
+    /// @brief NOTE_ON: the pitch
+    float pitch;
+
+    /// @brief NOTE_ON: the pan
+    float pan;
+
+    /// @brief RAMP: the length of the ramp in seconds
+    float duration;
+
+    /// @brief NOTE_ON: the sample to play
+    sound_sample sample;
+} sequencer_Event;
+
+/// @brief The voices + parameters of a sequence channel
+typedef struct
+{
+    sound_voiceHandle voices[2];
+    uint32_t numVoices;
+    float volume;
+    float pitch;
+    float pan;
+    double lastStartTime;
+} sequencer_Channel;
+
+/// @brief A list of events scheduled against the audio clock. Events are queued with sample-accurate timestamps a short
+/// lookahead window before they are due, so playback doesn't depend on when the game calls sound_update
+typedef struct sequencer_Sequence
+{
+    /// @brief Events, sorted by time
+    const sequencer_Event *events;
+    uint32_t numEvents;
+
+    /// @brief Length of the loop in seconds, or 0 to play the sequence once
+    double loopLength;
+
+    /// @brief How far ahead of the audio time to schedule events, in seconds. Must be longer than the time between sound_update calls
+    double lookahead;
+
+    /// @brief Priority of the voices started by the sequence (0 is highest, 255 is lowest)
+    uint8_t priority;
+
+    /// @brief Whether to apply reverb to the voices started by the sequence
+    uint8_t reverb;
+
+    uint8_t isPlaying;
+    double startTime;
+    uint32_t nextEvent;
+    sequencer_Channel channels[SEQUENCER_MAX_CHANNELS];
+    struct sequencer_Sequence *next;
+} sequencer_Sequence;
+
+/// @brief Initialize a sequence
+/// @param sequence The sequence to initialize
+/// @param events The events of the sequence, sorted by time. Must remain valid while the sequence is playing
+/// @param numEvents The number of events
+/// @param loopLength Length of the loop in seconds, or 0 to play the sequence once. Loops shorter than
+/// SEQUENCER_MIN_LOOP_LENGTH are lengthened to it, and a non-finite or negative length plays the sequence once
+/// @param priority Priority of the voices started by the sequence
+void sequencer_init(sequencer_Sequence *sequence, const sequencer_Event *events, uint32_t numEvents, double loopLength, uint8_t priority);
+
+/// @brief Start playing a sequence. Events are scheduled by sound_update
+/// @param sequence The sequence to play. Must remain valid until it finishes or sequencer_stop is called
+/// @param startTime The audio time (see audio_getTime) the sequence starts at
+void sequencer_play(sequencer_Sequence *sequence, double startTime);
+
+/// @brief Stop playing a sequence + all voices it started
+/// @param sequence The sequence to stop
+void sequencer_stop(sequencer_Sequence *sequence);
+
+/// @brief Schedule all events of the playing sequences which fall inside their lookahead window. Called by sound_update
+/// @param now The current audio time
+void sequencer_updateAll(double now);
+
+#ifdef __cplusplus
+}
+#endif
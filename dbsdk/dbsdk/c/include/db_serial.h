@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ Encoding:
+   unsigned integers               LEB128 varints, 7 bits per byte, low bits first
+   signed integers                 zigzag encoded varints, so small negative values stay small
+   floats                          little endian IEEE 754
+   strings                         varint (length << 1) followed by the UTF-8 bytes on first use, varint (index << 1) | 1
+                                   referring back to the index-th distinct string on later uses
+ There are no type tags, the reader has to read the same sequence of values the writer wrote.
+*/
+
+/// @brief A growable buffer values are serialized into
+typedef struct
+{
+    uint8_t *data;
+    uint32_t len;
+    uint32_t cap;
+    /// @brief Set if an allocation failed, later writes are dropped
+    uint8_t error;
+
+    /// @brief Open addressing table of the distinct strings written so far, for back references
+    uint32_t *strings;
+    uint32_t stringsCap;
+    uint32_t stringCount;
+} serial_Writer;
+
+/// @brief Reads values from a serialized buffer in a single pass
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t pos;
+    /// @brief Set when reading past the end or hitting malformed data, later reads return zero values
+    uint8_t error;
+    uint8_t ownsData;
+
+    /// @brief Offset + length of each distinct string read so far, for back references
+    uint32_t *strings;
+    uint32_t stringsCap;
+    uint32_t stringCount;
+} serial_Reader;
+
+/// @brief Initialize a writer
+/// @param writer The writer
+/// @param capacity Initial buffer size in bytes, the buffer grows as needed
+void serial_initWriter(serial_Writer *writer, uint32_t capacity);
+
+/// @brief Free the writer's buffer
+/// @param writer The writer
+void serial_freeWriter(serial_Writer *writer);
+
+/// @brief Discard the written data + string table, keeping the buffer for reuse
+/// @param writer The writer
+void serial_resetWriter(serial_Writer *writer);
+
+/// @brief Write an unsigned integer as a varint
+/// @param writer The writer
+/// @param value The value
+void serial_writeVarint(serial_Writer *writer, uint64_t value);
+
+/// @brief Write a signed integer as a zigzag encoded varint
+/// @param writer The writer
+/// @param value The value
+void serial_writeSigned(serial_Writer *writer, int64_t value);
+
+/// @brief Write a 32-bit float
+/// @param writer The writer
+/// @param value The value
+void serial_writeFloat32(serial_Writer *writer, float value);
+
+/// @brief Write a 64-bit float
+/// @param writer The writer
+/// @param value The value
+void serial_writeFloat64(serial_Writer *writer, double value);
+
+/// @brief Write raw bytes, without a length
+/// @param writer The writer
+/// @param data The bytes to write
+/// @param len Number of bytes
+void serial_writeBytes(serial_Writer *writer, const void *data, uint32_t len);
+
+/// @brief Write a string. Repeated strings are written once + referred back to
+/// @param writer The writer
+/// @param str The UTF-8 bytes of the string
+/// @param len Length of the string in bytes
+void serial_writeString(serial_Writer *writer, const char *str, uint32_t len);
+
+/// @brief Write the serialized data to a file with a single fs_write
+/// @param writer The writer
+/// @param path Path to the file
+/// @return True if the whole buffer was written, false otherwise
+uint8_t serial_saveFile(const serial_Writer *writer, const char *path);
+
+/// @brief Initialize a reader over a buffer. The buffer must remain valid while the reader is in use
+/// @param reader The reader
+/// @param data The serialized data
+/// @param len Length of the data
+void serial_initReader(serial_Reader *reader, const uint8_t *data, uint32_t len);
+
+/// @brief Initialize a reader with the contents of a file, read with a single fs_read
+/// @param reader The reader
+/// @param path Path to the file
+/// @return True if the file was read, false otherwise
+uint8_t serial_loadFile(serial_Reader *reader, const char *path);
+
+/// @brief Free the reader's string table, and its data if it was loaded with serial_loadFile
+/// @param reader The reader
+void serial_freeReader(serial_Reader *reader);
+
+/// @brief Read a varint written by serial_writeVarint
+/// @param reader The reader
+/// @return The value, or 0 if the reader has an error or the varint is malformed or truncated (error is set then)
+uint64_t serial_readVarint(serial_Reader *reader);
+
+/// @brief Read a signed integer written by serial_writeSigned
+/// @param reader The reader
+/// @return The value, or 0 on error
+int64_t serial_readSigned(serial_Reader *reader);
+
+/// @brief Read a 32-bit float written by serial_writeFloat32
+/// @param reader The reader
+/// @return The value, or 0 on error
+float serial_readFloat32(serial_Reader *reader);
+
+/// @brief Read a 64-bit float written by serial_writeFloat64
+/// @param reader The reader
+/// @return The value, or 0 on error
+double serial_readFloat64(serial_Reader *reader);
+
+/// @brief Read an element count, checked against the remaining data so corrupt counts can't cause huge allocations
+/// @param reader The reader
+/// @param minElementSize Smallest encoded size of an element in bytes
+/// @return The count, or 0 if it can't be valid (error is set then)
+uint32_t serial_readCount(serial_Reader *reader, uint32_t minElementSize);
+
+/// @brief Read raw bytes
+/// @param reader The reader
+/// @param len Number of bytes
+/// @return Pointer to the bytes within the reader's data, or NULL if fewer than len bytes remain
+const uint8_t *serial_readBytes(serial_Reader *reader, uint32_t len);
+
+/// @brief Read a string without copying it
+/// @param reader The reader
+/// @param outLen Receives the length of the string
+/// @return Pointer to the UTF-8 bytes within the reader's data (not NUL terminated), or NULL on error
+const char *serial_readString(serial_Reader *reader, uint32_t *outLen);
+
+#ifdef __cplusplus
+}
+#endif
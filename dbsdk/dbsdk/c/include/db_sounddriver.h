@@ -15,16 +15,58 @@ extern "C"
 #define SOUND_ATTEN_LINEAR 2
 #define SOUND_ATTEN_EXP_DISTANCE 3
 
+/// @brief Maximum number of emitters which may exist at once
+#ifndef SOUND_MAX_EMITTERS
+#define SOUND_MAX_EMITTERS 256
+#endif
+
+/// @brief Maximum number of distinct samples tracked by the sample cache. Loads past this are uploaded uncached
+#ifndef SOUND_MAX_CACHED_SAMPLES
+#define SOUND_MAX_CACHED_SAMPLES 256
+#endif
+
+/// @brief A handle which never refers to an emitter
+#define SOUND_INVALID_EMITTER 0
+
+/// @brief Stereo WAV files are mixed down to a single mono sample at load time
+#define SOUND_STEREO_DOWNMIX 0
+/// @brief Stereo WAV files are split into a sample per channel, played together on two hard-panned voices
+#define SOUND_STEREO_SPLIT 1
+
+#define SOUND_LOAD_ERROR 0
+#define SOUND_LOAD_PENDING 1
+#define SOUND_LOAD_DONE 2
+
+/// @brief Number of segments a stream keeps queued on the hardware
+#define SOUND_STREAM_SEGMENTS 2
+
+/// @brief How far ahead of the current time a stream schedules its first segment, in seconds
+#define SOUND_STREAM_LEAD_TIME 0.05
+
 /// @brief Represents a loaded sound sample
 typedef struct
 {
     int32_t handle;
     uint32_t samplerate;
+    /// @brief Length of the sample in sample frames, or 0 if unknown
+    uint32_t length;
+    /// @brief Whether the sample was loaded with SOUND_STEREO_SPLIT, in which case handle holds the left channel and handleRight the right
+    uint8_t stereo;
+    int32_t handleRight;
 } sound_sample;
 
 struct sound_emitter;
 struct sound_voice;
 
+/// @brief Handle to a hardware voice started by sound_playOneShotAt. Handles to voices which have since been reused are ignored
+typedef uint32_t sound_voiceHandle;
+
+/// @brief A voice handle which never refers to a voice
+#define SOUND_INVALID_VOICE 0xFFFFFFFF
+
+/// @brief Generation-checked handle to a sound emitter. Handles to destroyed emitters are detected and ignored
+typedef uint32_t sound_handle;
+
 /// @brief Struct containing the state of a sound emitter
 typedef struct sound_emitter
 {
@@ -42,28 +84,149 @@ typedef struct sound_emitter
     float pitch;
     float pan;
     sound_sample sample;
+    /// @brief Playback position in seconds, tracked whether or not the emitter currently has a hardware voice
+    float playPosition;
+    double playUpdateTime;
     uint32_t id;
+    uint32_t idRight;
+    uint16_t generation;
     struct sound_voice *voice;
+    struct sound_voice *voiceRight;
     struct sound_emitter *prev;
     struct sound_emitter *next;
 } sound_emitter;
 
+/// @brief Format + location of the sample data in a WAV file
+typedef struct
+{
+    uint16_t formatType;
+    uint16_t bitsPerSample;
+    uint16_t blockAlign;
+    uint16_t channels;
+    uint32_t samplerate;
+    uint32_t dataOffset;
+    uint32_t dataLen;
+} sound_wavInfo;
+
+/// @brief State of an incremental WAV load, see sound_beginLoadWav
+typedef struct
+{
+    IOFILE *file;
+    sound_wavInfo info;
+    uint8_t stereoMode;
+    uint8_t *buffer;
+    uint32_t bytesRead;
+    /// @brief The loaded sample, valid once sound_continueLoadWav returns SOUND_LOAD_DONE
+    sound_sample sample;
+} sound_wavLoader;
+
+/// @brief A segment of a stream uploaded to the audio system
+typedef struct
+{
+    sound_sample sample;
+    double endTime;
+    struct sound_voice *voice;
+    uint32_t voiceId;
+} sound_streamSegment;
+
+/// @brief A WAV file played directly from disc. The file is read one segment at a time through a fixed staging buffer,
+/// each segment is uploaded as its own sample and scheduled to start as the previous one ends
+typedef struct
+{
+    IOFILE *file;
+    sound_wavInfo info;
+    uint8_t *staging;
+    uint32_t segmentLen;
+    uint32_t dataPos;
+    uint8_t priority;
+    uint8_t loop;
+    uint8_t isPlaying;
+    float volume;
+    float pan;
+    double nextStartTime;
+    sound_streamSegment segments[SOUND_STREAM_SEGMENTS];
+} sound_stream;
+
 /// @brief Initialize the sound driver
 void sound_init();
 
-/// @brief Update sound playback
+/// @brief Update sound playback + schedule the next window of sequencer events. Emitters are ranked by priority and then by audible gain, the highest ranked get hardware voices
+/// and the rest are virtualized until they become audible again
 void sound_update();
 
-/// @brief Load a sample from a .WAV file
+/// @brief Load a sample from a .WAV file. Stereo files are mixed down to mono
 /// @param file Handle to the open WAV file
 /// @return The loaded sample handle
 sound_sample sound_loadWav(IOFILE *file);
 
-/// @brief Load a sample from a .WAV file blob
+/// @brief Load a sample from a .WAV file, choosing how stereo files are handled
+/// @param file Handle to the open WAV file
+/// @param stereoMode SOUND_STEREO_DOWNMIX or SOUND_STEREO_SPLIT. Stereo ADPCM files are always split
+/// @return The loaded sample handle
+sound_sample sound_loadWavStereo(IOFILE *file, uint8_t stereoMode);
+
+/// @brief Begin loading a sample from a .WAV file a piece at a time, so the load can be spread across several frames
+/// @param loader The loader state to initialize
+/// @param file Handle to the open WAV file. Must stay open until the load finishes
+/// @param stereoMode SOUND_STEREO_DOWNMIX or SOUND_STEREO_SPLIT. Stereo ADPCM files are always split
+/// @return True if the WAV headers were read and the load can continue, false otherwise
+uint8_t sound_beginLoadWav(sound_wavLoader *loader, IOFILE *file, uint8_t stereoMode);
+
+/// @brief Continue an incremental WAV load
+/// @param loader The loader state
+/// @param maxBytes Maximum number of bytes to read this call
+/// @return SOUND_LOAD_PENDING if there is more to read, SOUND_LOAD_DONE once loader->sample is ready, or SOUND_LOAD_ERROR
+uint8_t sound_continueLoadWav(sound_wavLoader *loader, uint32_t maxBytes);
+
+/// @brief Get the progress of an incremental WAV load
+/// @param loader The loader state
+/// @return Fraction of the sample data read so far, from 0 to 1
+float sound_loadWavProgress(const sound_wavLoader *loader);
+
+/// @brief Open a .WAV file for streaming playback and begin playing it. Stereo PCM streams are mixed down to mono,
+/// stereo ADPCM streams are unsupported
+/// @param stream The stream state to initialize
+/// @param file Handle to the open WAV file. Must stay open until the stream is closed
+/// @param segmentLen Size of the staging buffer + each uploaded segment in bytes
+/// @param priority The priority of the stream's voices (0 is highest, 255 is lowest)
+/// @param loop Whether to loop the stream
+/// @param volume The volume of the stream
+/// @param pan The pan of the stream
+/// @return True if the stream was opened, false otherwise
+uint8_t sound_openStream(sound_stream *stream, IOFILE *file, uint32_t segmentLen, uint8_t priority, uint8_t loop, float volume, float pan);
+
+/// @brief Read + queue stream segments as earlier ones finish. Call once per frame while the stream is playing
+/// @param stream The stream
+void sound_updateStream(sound_stream *stream);
+
+/// @brief Stop a stream and release its segments + staging buffer. Does not close the file
+/// @param stream The stream
+void sound_closeStream(sound_stream *stream);
+
+/// @brief Load a sample from a .WAV file blob. Stereo files are mixed down to mono
 /// @param data Pointer to the wav file bytes
 /// @return The loaded sample handle
 sound_sample sound_loadWavBytes(const uint8_t *data);
 
+/// @brief Load a sample from a .WAV file blob, choosing how stereo files are handled
+/// @param data Pointer to the wav file bytes
+/// @param stereoMode SOUND_STEREO_DOWNMIX or SOUND_STEREO_SPLIT. Stereo ADPCM files are always split
+/// @return The loaded sample handle
+sound_sample sound_loadWavBytesStereo(const uint8_t *data, uint8_t stereoMode);
+
+/// @brief Load a sample from a .WAV file blob of known size. The headers are checked against the size, so truncated or
+/// corrupt files are rejected instead of read past the end of the buffer
+/// @param data Pointer to the wav file bytes
+/// @param dataLen Length of the wav file bytes
+/// @param stereoMode SOUND_STEREO_DOWNMIX or SOUND_STEREO_SPLIT. Stereo ADPCM files are always split
+/// @return The loaded sample handle
+sound_sample sound_loadWavBytesLen(const uint8_t *data, uint32_t dataLen, uint8_t stereoMode);
+
+/// @brief Release a sample returned by one of the sound_loadWav* functions. Loading the same sample data again
+/// returns the already uploaded sample, so samples are reference counted + the audio memory is freed with the last release
+/// @param sample The sample to release
+void sound_releaseSample(sound_sample sample);
+
 /// @brief Play a one-shot sample
 /// @param priority The priority of the sound (0 is highest, 255 is lowest)
 /// @param sample The sample to play
@@ -73,7 +236,33 @@ sound_sample sound_loadWavBytes(const uint8_t *data);
 /// @param pan The pan of the sound
 void sound_playOneShot(uint8_t priority, sound_sample sample, uint8_t reverb, float volume, float pitch, float pan);
 
-/// @brief Play a one-shot sample in 3D
+/// @brief Play a one-shot sample starting at a precise time, for sequencing
+/// @param priority The priority of the sound (0 is highest, 255 is lowest)
+/// @param sample The sample to play
+/// @param reverb Whether to apply reverb to the sound
+/// @param loop Whether to loop the sample until stopped with sound_stopVoiceAt
+/// @param volume The volume of the sound
+/// @param pitch The pitch of the sound
+/// @param pan The pan of the sound
+/// @param time The audio time (see audio_getTime) to start playing at
+/// @param outVoices If not NULL, receives a handle per voice started (SOUND_INVALID_VOICE if none was available). Must hold 2 handles for stereo samples
+/// @return The number of voices the sample needs (2 for split stereo samples, 1 otherwise)
+uint32_t sound_playOneShotAt(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan, double time, sound_voiceHandle *outVoices);
+
+/// @brief Stop a voice started by sound_playOneShotAt at a precise time
+/// @param voice The voice handle
+/// @param time The audio time to stop at
+void sound_stopVoiceAt(sound_voiceHandle voice, double time);
+
+/// @brief Change a float parameter of a voice started by sound_playOneShotAt at a precise time
+/// @param voice The voice handle
+/// @param param The parameter to change (AUDIO_VOICEPARAM_VOLUME, AUDIO_VOICEPARAM_PITCH, AUDIO_VOICEPARAM_PAN, etc). Unknown
+/// parameters are ignored
+/// @param value The new value
+/// @param time The audio time to change the parameter at
+void sound_setVoiceParamAt(sound_voiceHandle voice, uint32_t param, float value, double time);
+
+/// @brief Play a one-shot sample in 3D. Attenuation + pan are calculated once from the current listener state, no emitter is created
 /// @param priority The priority of the sound (0 is highest, 255 is lowest)
 /// @param sample The sample to play
 /// @param reverb Whether to apply reverb to the sound
@@ -86,7 +275,7 @@ void sound_playOneShot(uint8_t priority, sound_sample sample, uint8_t reverb, fl
 /// @param attenRolloff The rolloff factor of the sound
 void sound_playOneShot3D(uint8_t priority, sound_sample sample, uint8_t reverb, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff);
 
-/// @brief Begin playing a sound, returning a pointer to the emitter
+/// @brief Begin playing a sound, returning a handle to the emitter
 /// @param priority The priority of the sound (0 is highest, 255 is lowest)
 /// @param sample The sample to play
 /// @param reverb Whether to apply reverb to the sound
@@ -94,10 +283,11 @@ void sound_playOneShot3D(uint8_t priority, sound_sample sample, uint8_t reverb,
 /// @param volume The initial volume
 /// @param pitch The initial pitch
 /// @param pan The initial pan
-/// @return A pointer to the virtual voice
-sound_emitter *sound_play(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan);
+/// @return A handle to the emitter, or SOUND_INVALID_EMITTER if SOUND_MAX_EMITTERS emitters already exist. Non-looping
+/// emitters return to the pool once they finish playing, looping emitters have to be destroyed with sound_destroy
+sound_handle sound_play(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan);
 
-/// @brief Begin playing a 3D sound, returning a pointer to the emitter
+/// @brief Begin playing a 3D sound, returning a handle to the emitter
 /// @param priority The priority of the sound (0 is highest, 255 is lowest)
 /// @param sample The sample to play
 /// @param reverb Whether to apply reverb to the sound
@@ -109,21 +299,27 @@ sound_emitter *sound_play(uint8_t priority, sound_sample sample, uint8_t reverb,
 /// @param attenMinDistance The min distance of the emitter
 /// @param attenMaxDistance The max distance of the emitter
 /// @param attenRolloff The rolloff factor of the emitter
-/// @return A pointer to the virtual voice
-sound_emitter *sound_play3D(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff);
+/// @return A handle to the emitter, or SOUND_INVALID_EMITTER if SOUND_MAX_EMITTERS emitters already exist. Non-looping
+/// emitters return to the pool once they finish playing, looping emitters have to be destroyed with sound_destroy
+sound_handle sound_play3D(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff);
+
+/// @brief Get the emitter a handle refers to
+/// @param handle The emitter handle
+/// @return A pointer to the emitter, or NULL if the emitter has been destroyed or was a one-shot that finished playing
+sound_emitter *sound_getEmitter(sound_handle handle);
 
-/// @brief Destroy the sound emitter
-/// @param voice The emitter handle
-void sound_destroy(sound_emitter *voice);
+/// @brief Destroy the sound emitter, returning it to the emitter pool
+/// @param handle The emitter handle
+void sound_destroy(sound_handle handle);
 
 /// @brief Stop playing the sound emitter
-/// @param voice A pointer to the emitter
-void sound_stop(sound_emitter *voice);
+/// @param handle The emitter handle
+void sound_stop(sound_handle handle);
 
 /// @brief Update the position of the emitter
-/// @param voice The emitter to update
+/// @param handle The emitter handle
 /// @param position The new position
-void sound_setPosition(sound_emitter *voice, Vec3 position);
+void sound_setPosition(sound_handle handle, Vec3 position);
 
 /// @brief Set the position and orientation of the listener
 /// @param listenerPosition The position of the listener
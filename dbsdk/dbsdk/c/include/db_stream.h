@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "db_io.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// @brief Read-ahead block size used by stream_open when none is given
+#ifndef STREAM_DEFAULT_BLOCK_SIZE
+#define STREAM_DEFAULT_BLOCK_SIZE (32 * 1024)
+#endif
+
+/// @brief A buffered reader over an IOFILE. Small reads, peeks + skips are served from a read-ahead block, so parsers
+/// which make many small reads only cost a host call per block
+typedef struct
+{
+    IOFILE *file;
+    uint8_t *buffer;
+    uint32_t bufferSize;
+
+    /// @brief Read position within the buffer
+    uint32_t bufferPos;
+
+    /// @brief Number of valid bytes in the buffer
+    uint32_t bufferLen;
+
+    /// @brief File offset of the first byte in the buffer
+    uint32_t bufferOffset;
+
+    uint8_t ownsBuffer;
+    uint8_t eof;
+} stream_Reader;
+
+/// @brief Initialize a reader with a caller-provided buffer, starting at a known file position. Makes no host calls
+/// @param reader The reader to initialize
+/// @param file The file to read from
+/// @param position The current position of the file
+/// @param buffer The read-ahead buffer. Must remain valid while the reader is in use
+/// @param bufferSize Size of the buffer in bytes
+void stream_initAt(stream_Reader *reader, IOFILE *file, uint32_t position, uint8_t *buffer, uint32_t bufferSize);
+
+/// @brief Open a reader at the current position of a file, allocating its read-ahead buffer
+/// @param reader The reader to initialize
+/// @param file The file to read from
+/// @param blockSize Size of the read-ahead block, or 0 for STREAM_DEFAULT_BLOCK_SIZE
+/// @return True if the buffer was allocated, false otherwise
+uint8_t stream_open(stream_Reader *reader, IOFILE *file, uint32_t blockSize);
+
+/// @brief Free the buffer allocated by stream_open. The file is not closed
+/// @param reader The reader
+void stream_close(stream_Reader *reader);
+
+/// @brief Read bytes from the stream. Reads larger than the block go straight to the destination
+/// @param reader The reader
+/// @param dst Buffer to read into
+/// @param len Number of bytes to read
+/// @return The number of bytes read, less than len at the end of the file
+uint32_t stream_read(stream_Reader *reader, void *dst, uint32_t len);
+
+/// @brief Get a pointer to the next bytes of the stream without consuming them
+/// @param reader The reader
+/// @param len Number of bytes to peek, at most the block size
+/// @return Pointer to the bytes, valid until the next call on the reader, or NULL if fewer than len bytes remain
+const uint8_t *stream_peek(stream_Reader *reader, uint32_t len);
+
+/// @brief Skip bytes. Skips within the buffered block make no host calls
+/// @param reader The reader
+/// @param len Number of bytes to skip
+void stream_skip(stream_Reader *reader, uint32_t len);
+
+/// @brief Get the position of the stream in the file
+/// @param reader The reader
+/// @return The file offset of the next byte to be read
+uint32_t stream_tell(const stream_Reader *reader);
+
+/// @brief Seek to an absolute position. Seeks within the buffered block make no host calls
+/// @param reader The reader
+/// @param position The file offset to seek to
+void stream_seek(stream_Reader *reader, uint32_t position);
+
+/// @brief Check whether the end of the file has been reached
+/// @param reader The reader
+/// @return True if no more bytes can be read
+uint8_t stream_eof(stream_Reader *reader);
+
+/// @brief Move the underlying file to the stream position, undoing any read-ahead, so the file can be read directly again
+/// @param reader The reader
+void stream_syncFile(stream_Reader *reader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,462 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "db_broadphase.h"
+#include "db_log.h"
+
+// marks an entity slot as in use (nextFree of a live entity)
+#define ENTITY_LIVE 0xFFFFFFFE
+
+#define LIST_END 0xFFFFFFFF
+
+// cell coordinates stay well inside int32_t so cell extents (max - min + 1) can't overflow
+#define CELL_COORD_LIMIT 1073741824.0f
+
+// the cell range covering a box, as {minX, minY, minZ, maxX, maxY, maxZ}
+// returns false if a bound isn't finite or lies too far out to have an int32_t cell coordinate
+static bool cellRange(const broadphase_Grid *grid, Vec3 min, Vec3 max, int32_t *range)
+{
+    float bounds[6] = {min.x, min.y, min.z, max.x, max.y, max.z};
+    for (int i = 0; i < 6; i++)
+    {
+        float c = floorf(bounds[i] * grid->invCellSize);
+
+        // also false for NaN
+        if (!(c > -CELL_COORD_LIMIT && c < CELL_COORD_LIMIT))
+            return false;
+
+        range[i] = (int32_t)c;
+    }
+    return true;
+}
+
+// the number of cells covered by a cell range, 0 if the range is inverted
+static uint64_t rangeCellCount(const int32_t *range)
+{
+    if (range[3] < range[0] || range[4] < range[1] || range[5] < range[2])
+        return 0;
+
+    return (uint64_t)(range[3] - range[0] + 1) *
+           (uint64_t)(range[4] - range[1] + 1) *
+           (uint64_t)(range[5] - range[2] + 1);
+}
+
+// the cell range an entity with the given bounds would cover
+// returns false if the bounds are invalid or cover more cells than the grid has cell entries
+static bool entityCellRange(const broadphase_Grid *grid, Vec3 min, Vec3 max, int32_t *range)
+{
+    if (!cellRange(grid, min, max, range))
+        return false;
+
+    uint64_t cells = rangeCellCount(range);
+    return cells > 0 && cells <= grid->entryCapacity;
+}
+
+static inline uint32_t hashCell(const broadphase_Grid *grid, int32_t x, int32_t y, int32_t z)
+{
+    return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u)) & grid->bucketMask;
+}
+
+static inline bool entityOverlaps(const broadphase_Grid *grid, uint32_t id, Vec3 min, Vec3 max)
+{
+    return grid->minX[id] <= max.x && grid->maxX[id] >= min.x &&
+           grid->minY[id] <= max.y && grid->maxY[id] >= min.y &&
+           grid->minZ[id] <= max.z && grid->maxZ[id] >= min.z;
+}
+
+static inline bool entitiesOverlap(const broadphase_Grid *grid, uint32_t a, uint32_t b)
+{
+    return grid->minX[a] <= grid->maxX[b] && grid->maxX[a] >= grid->minX[b] &&
+           grid->minY[a] <= grid->maxY[b] && grid->maxY[a] >= grid->minY[b] &&
+           grid->minZ[a] <= grid->maxZ[b] && grid->maxZ[a] >= grid->minZ[b];
+}
+
+static inline bool entityOverlapsSphere(const broadphase_Grid *grid, uint32_t id, Vec3 center, float radiusSq)
+{
+    // distance from the sphere center to the closest point on the box
+    float dx = fmaxf(fmaxf(grid->minX[id] - center.x, center.x - grid->maxX[id]), 0.0f);
+    float dy = fmaxf(fmaxf(grid->minY[id] - center.y, center.y - grid->maxY[id]), 0.0f);
+    float dz = fmaxf(fmaxf(grid->minZ[id] - center.z, center.z - grid->maxZ[id]), 0.0f);
+    return (dx * dx + dy * dy + dz * dz) <= radiusSq;
+}
+
+// begin a query - returns a stamp which hasn't been written to any entity yet
+static uint32_t nextStamp(broadphase_Grid *grid)
+{
+    grid->currentStamp++;
+    if (grid->currentStamp == 0)
+    {
+        memset(grid->queryStamp, 0, sizeof(uint32_t) * grid->capacity);
+        grid->currentStamp = 1;
+    }
+    return grid->currentStamp;
+}
+
+// add cell entries for every cell the entity's cell range covers
+// returns false (without linking anything) if there aren't enough free entries
+static bool linkEntity(broadphase_Grid *grid, uint32_t id)
+{
+    // count free entries first so a failed link doesn't need to be rolled back
+    // the cell range was checked by entityCellRange, so the count fits in the entry capacity
+    int32_t range[6] = {grid->cellMinX[id], grid->cellMinY[id], grid->cellMinZ[id], grid->cellMaxX[id], grid->cellMaxY[id], grid->cellMaxZ[id]};
+    uint32_t needed = (uint32_t)rangeCellCount(range);
+    uint32_t available = 0;
+    for (uint32_t e = grid->entryFreeHead; e != LIST_END && available < needed; e = grid->entryNext[e])
+    {
+        available++;
+    }
+
+    if (available < needed)
+    {
+        return false;
+    }
+
+    for (int32_t z = grid->cellMinZ[id]; z <= grid->cellMaxZ[id]; z++)
+    {
+        for (int32_t y = grid->cellMinY[id]; y <= grid->cellMaxY[id]; y++)
+        {
+            for (int32_t x = grid->cellMinX[id]; x <= grid->cellMaxX[id]; x++)
+            {
+                uint32_t entry = grid->entryFreeHead;
+                grid->entryFreeHead = grid->entryNext[entry];
+
+                uint32_t bucket = hashCell(grid, x, y, z);
+                grid->entryEntity[entry] = id;
+                grid->entryCellX[entry] = x;
+                grid->entryCellY[entry] = y;
+                grid->entryCellZ[entry] = z;
+                grid->entryNext[entry] = grid->buckets[bucket];
+                grid->buckets[bucket] = entry;
+            }
+        }
+    }
+
+    return true;
+}
+
+// remove every cell entry belonging to the entity
+static void unlinkEntity(broadphase_Grid *grid, uint32_t id)
+{
+    for (int32_t z = grid->cellMinZ[id]; z <= grid->cellMaxZ[id]; z++)
+    {
+        for (int32_t y = grid->cellMinY[id]; y <= grid->cellMaxY[id]; y++)
+        {
+            for (int32_t x = grid->cellMinX[id]; x <= grid->cellMaxX[id]; x++)
+            {
+                uint32_t *link = &grid->buckets[hashCell(grid, x, y, z)];
+                while (*link != LIST_END)
+                {
+                    uint32_t entry = *link;
+                    if (grid->entryEntity[entry] == id && grid->entryCellX[entry] == x && grid->entryCellY[entry] == y && grid->entryCellZ[entry] == z)
+                    {
+                        *link = grid->entryNext[entry];
+                        grid->entryNext[entry] = grid->entryFreeHead;
+                        grid->entryFreeHead = entry;
+                        break;
+                    }
+                    link = &grid->entryNext[entry];
+                }
+            }
+        }
+    }
+}
+
+static void setBounds(broadphase_Grid *grid, uint32_t id, Vec3 min, Vec3 max)
+{
+    grid->minX[id] = min.x;
+    grid->minY[id] = min.y;
+    grid->minZ[id] = min.z;
+    grid->maxX[id] = max.x;
+    grid->maxY[id] = max.y;
+    grid->maxZ[id] = max.z;
+}
+
+static void setCellRange(broadphase_Grid *grid, uint32_t id, const int32_t *range)
+{
+    grid->cellMinX[id] = range[0];
+    grid->cellMinY[id] = range[1];
+    grid->cellMinZ[id] = range[2];
+    grid->cellMaxX[id] = range[3];
+    grid->cellMaxY[id] = range[4];
+    grid->cellMaxZ[id] = range[5];
+}
+
+uint8_t broadphase_init(broadphase_Grid *grid, float cellSize, uint32_t maxEntities, uint32_t maxCellEntries)
+{
+    memset(grid, 0, sizeof(broadphase_Grid));
+
+    uint32_t bucketCount = 1;
+    while (bucketCount < maxCellEntries)
+    {
+        bucketCount <<= 1;
+    }
+
+    // every array holds 4-byte elements, so they can all share one allocation
+    size_t entityArrays = 15;
+    size_t entryArrays = 5;
+    size_t size = sizeof(uint32_t) * (entityArrays * maxEntities + entryArrays * maxCellEntries + bucketCount);
+    uint32_t *block = malloc(size);
+
+    if (block == NULL)
+    {
+        db_log("Failed to allocate broadphase grid");
+        return false;
+    }
+
+    grid->cellSize = cellSize;
+    grid->invCellSize = 1.0f / cellSize;
+    grid->capacity = maxEntities;
+    grid->entryCapacity = maxCellEntries;
+    grid->bucketMask = bucketCount - 1;
+
+    grid->minX = (float *)block;
+    grid->minY = grid->minX + maxEntities;
+    grid->minZ = grid->minY + maxEntities;
+    grid->maxX = grid->minZ + maxEntities;
+    grid->maxY = grid->maxX + maxEntities;
+    grid->maxZ = grid->maxY + maxEntities;
+    grid->userData = (uint32_t *)(grid->maxZ + maxEntities);
+    grid->cellMinX = (int32_t *)(grid->userData + maxEntities);
+    grid->cellMinY = grid->cellMinX + maxEntities;
+    grid->cellMinZ = grid->cellMinY + maxEntities;
+    grid->cellMaxX = grid->cellMinZ + maxEntities;
+    grid->cellMaxY = grid->cellMaxX + maxEntities;
+    grid->cellMaxZ = grid->cellMaxY + maxEntities;
+    grid->nextFree = (uint32_t *)(grid->cellMaxZ + maxEntities);
+    grid->queryStamp = grid->nextFree + maxEntities;
+    grid->entryEntity = grid->queryStamp + maxEntities;
+    grid->entryNext = grid->entryEntity + maxCellEntries;
+    grid->entryCellX = (int32_t *)(grid->entryNext + maxCellEntries);
+    grid->entryCellY = grid->entryCellX + maxCellEntries;
+    grid->entryCellZ = grid->entryCellY + maxCellEntries;
+    grid->buckets = (uint32_t *)(grid->entryCellZ + maxCellEntries);
+
+    broadphase_clear(grid);
+    return true;
+}
+
+void broadphase_destroy(broadphase_Grid *grid)
+{
+    // all arrays live in the block starting at minX
+    free(grid->minX);
+    memset(grid, 0, sizeof(broadphase_Grid));
+}
+
+void broadphase_clear(broadphase_Grid *grid)
+{
+    grid->count = 0;
+    grid->currentStamp = 0;
+
+    for (uint32_t i = 0; i < grid->capacity; i++)
+    {
+        grid->nextFree[i] = i + 1 < grid->capacity ? i + 1 : LIST_END;
+        grid->queryStamp[i] = 0;
+    }
+    grid->freeHead = grid->capacity > 0 ? 0 : LIST_END;
+
+    for (uint32_t i = 0; i < grid->entryCapacity; i++)
+    {
+        grid->entryNext[i] = i + 1 < grid->entryCapacity ? i + 1 : LIST_END;
+    }
+    grid->entryFreeHead = grid->entryCapacity > 0 ? 0 : LIST_END;
+
+    memset(grid->buckets, 0xFF, sizeof(uint32_t) * (grid->bucketMask + 1));
+}
+
+uint32_t broadphase_insert(broadphase_Grid *grid, Vec3 min, Vec3 max, uint32_t userData)
+{
+    uint32_t id = grid->freeHead;
+    if (id == LIST_END)
+    {
+        return BROADPHASE_INVALID_ID;
+    }
+
+    int32_t range[6];
+    if (!entityCellRange(grid, min, max, range))
+    {
+        return BROADPHASE_INVALID_ID;
+    }
+
+    setBounds(grid, id, min, max);
+    setCellRange(grid, id, range);
+
+    if (!linkEntity(grid, id))
+    {
+        return BROADPHASE_INVALID_ID;
+    }
+
+    grid->freeHead = grid->nextFree[id];
+    grid->nextFree[id] = ENTITY_LIVE;
+    grid->userData[id] = userData;
+    grid->queryStamp[id] = 0;
+    grid->count++;
+
+    return id;
+}
+
+uint8_t broadphase_update(broadphase_Grid *grid, uint32_t id, Vec3 min, Vec3 max)
+{
+    if (id >= grid->capacity || grid->nextFree[id] != ENTITY_LIVE)
+        return false;
+
+    // invalid bounds leave the entity as it was
+    int32_t range[6];
+    if (!entityCellRange(grid, min, max, range))
+        return false;
+
+    setBounds(grid, id, min, max);
+
+    // common case: still covering the same cells, nothing to relink
+    if (range[0] == grid->cellMinX[id] && range[1] == grid->cellMinY[id] && range[2] == grid->cellMinZ[id] &&
+        range[3] == grid->cellMaxX[id] && range[4] == grid->cellMaxY[id] && range[5] == grid->cellMaxZ[id])
+    {
+        return true;
+    }
+
+    unlinkEntity(grid, id);
+    setCellRange(grid, id, range);
+
+    if (!linkEntity(grid, id))
+    {
+        // the entity is no longer in any cell, release it rather than leave it unreachable
+        grid->nextFree[id] = grid->freeHead;
+        grid->freeHead = id;
+        grid->count--;
+        return false;
+    }
+
+    return true;
+}
+
+void broadphase_remove(broadphase_Grid *grid, uint32_t id)
+{
+    if (id >= grid->capacity || grid->nextFree[id] != ENTITY_LIVE)
+        return;
+
+    unlinkEntity(grid, id);
+
+    grid->nextFree[id] = grid->freeHead;
+    grid->freeHead = id;
+    grid->count--;
+}
+
+// an entity matches a query if it overlaps the box, and the sphere too if center isn't NULL
+static inline bool entityMatches(const broadphase_Grid *grid, uint32_t id, Vec3 min, Vec3 max, const Vec3 *center, float radiusSq)
+{
+    return entityOverlaps(grid, id, min, max) && (center == NULL || entityOverlapsSphere(grid, id, *center, radiusSq));
+}
+
+// gather the entities in the cells covering the box. the sphere test runs during the gather, so maxIds is only spent on
+// entities which actually match
+static uint32_t query(broadphase_Grid *grid, Vec3 min, Vec3 max, const Vec3 *center, float radiusSq, uint32_t *outIds, uint32_t maxIds)
+{
+    uint32_t found = 0;
+
+    // inverted boxes (or NaN bounds) match nothing
+    if (!(min.x <= max.x && min.y <= max.y && min.z <= max.z))
+        return 0;
+
+    int32_t range[6];
+    bool inRange = cellRange(grid, min, max, range);
+
+    // huge query boxes touch more cells than there are entities (or reach past the cell coordinate range) - just test
+    // every entity
+    if (!inRange || rangeCellCount(range) > grid->capacity)
+    {
+        for (uint32_t id = 0; id < grid->capacity && found < maxIds; id++)
+        {
+            if (grid->nextFree[id] == ENTITY_LIVE && entityMatches(grid, id, min, max, center, radiusSq))
+            {
+                outIds[found++] = id;
+            }
+        }
+        return found;
+    }
+
+    uint32_t stamp = nextStamp(grid);
+
+    for (int32_t z = range[2]; z <= range[5]; z++)
+    {
+        for (int32_t y = range[1]; y <= range[4]; y++)
+        {
+            for (int32_t x = range[0]; x <= range[3]; x++)
+            {
+                for (uint32_t e = grid->buckets[hashCell(grid, x, y, z)]; e != LIST_END; e = grid->entryNext[e])
+                {
+                    uint32_t id = grid->entryEntity[e];
+
+                    if (grid->queryStamp[id] == stamp || grid->entryCellX[e] != x || grid->entryCellY[e] != y || grid->entryCellZ[e] != z)
+                        continue;
+
+                    grid->queryStamp[id] = stamp;
+
+                    if (entityMatches(grid, id, min, max, center, radiusSq))
+                    {
+                        if (found == maxIds)
+                            return found;
+
+                        outIds[found++] = id;
+                    }
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+uint32_t broadphase_queryAABB(broadphase_Grid *grid, Vec3 min, Vec3 max, uint32_t *outIds, uint32_t maxIds)
+{
+    return query(grid, min, max, NULL, 0.0f, outIds, maxIds);
+}
+
+uint32_t broadphase_queryRadius(broadphase_Grid *grid, Vec3 center, float radius, uint32_t *outIds, uint32_t maxIds)
+{
+    // search the sphere's bounding box, keeping only the entities touching the sphere
+    Vec3 extent = (Vec3){radius, radius, radius};
+    return query(grid, vec3_sub(center, extent), vec3_add(center, extent), &center, radius * radius, outIds, maxIds);
+}
+
+uint32_t broadphase_findPairs(broadphase_Grid *grid, broadphase_Pair *outPairs, uint32_t maxPairs)
+{
+    uint32_t found = 0;
+
+    for (uint32_t bucket = 0; bucket <= grid->bucketMask; bucket++)
+    {
+        for (uint32_t e = grid->buckets[bucket]; e != LIST_END; e = grid->entryNext[e])
+        {
+            uint32_t a = grid->entryEntity[e];
+            int32_t x = grid->entryCellX[e];
+            int32_t y = grid->entryCellY[e];
+            int32_t z = grid->entryCellZ[e];
+
+            for (uint32_t f = grid->entryNext[e]; f != LIST_END; f = grid->entryNext[f])
+            {
+                // different cell which happens to hash to the same bucket
+                if (grid->entryCellX[f] != x || grid->entryCellY[f] != y || grid->entryCellZ[f] != z)
+                    continue;
+
+                uint32_t b = grid->entryEntity[f];
+
+                // entities sharing several cells would be seen once per shared cell
+                // only report the pair from the lowest cell both entities occupy
+                if (x != (grid->cellMinX[a] > grid->cellMinX[b] ? grid->cellMinX[a] : grid->cellMinX[b]) ||
+                    y != (grid->cellMinY[a] > grid->cellMinY[b] ? grid->cellMinY[a] : grid->cellMinY[b]) ||
+                    z != (grid->cellMinZ[a] > grid->cellMinZ[b] ? grid->cellMinZ[a] : grid->cellMinZ[b]))
+                    continue;
+
+                if (!entitiesOverlap(grid, a, b))
+                    continue;
+
+                if (found == maxPairs)
+                    return found;
+
+                outPairs[found++] = a < b ? (broadphase_Pair){a, b} : (broadphase_Pair){b, a};
+            }
+        }
+    }
+
+    return found;
+}
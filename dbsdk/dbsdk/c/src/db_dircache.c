@@ -0,0 +1,210 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_dircache.h"
+#include "db_io.h"
+#include "db_log.h"
+
+static const char *_sortNames;
+
+static int compareEntries(const void *a, const void *b)
+{
+    return strcmp(_sortNames + ((const dircache_Entry *)a)->nameOffset, _sortNames + ((const dircache_Entry *)b)->nameOffset);
+}
+
+static uint8_t addEntry(dircache_Dir *dir, const IODIRENT *dirent)
+{
+    uint32_t nameLen = (uint32_t)strnlen(dirent->name, sizeof(dirent->name));
+
+    if (dir->count == dir->entriesCap)
+    {
+        uint32_t cap = dir->entriesCap > 0 ? dir->entriesCap * 2 : 16;
+        dircache_Entry *entries = realloc(dir->entries, cap * sizeof(dircache_Entry));
+        if (entries == NULL)
+            return false;
+
+        dir->entries = entries;
+        dir->entriesCap = cap;
+    }
+
+    if (dir->namesLen + nameLen + 1 > dir->namesCap)
+    {
+        uint32_t cap = dir->namesCap > 0 ? dir->namesCap : 256;
+        while (cap < dir->namesLen + nameLen + 1)
+        {
+            cap *= 2;
+        }
+
+        char *names = realloc(dir->names, cap);
+        if (names == NULL)
+            return false;
+
+        dir->names = names;
+        dir->namesCap = cap;
+    }
+
+    dircache_Entry *entry = &dir->entries[dir->count++];
+    entry->nameOffset = dir->namesLen;
+    entry->nameLen = (uint16_t)nameLen;
+    entry->size = dirent->size;
+    entry->modified = dirent->modified;
+    entry->flags = dirent->isDirectory ? DIRCACHE_FLAG_DIRECTORY : 0;
+
+    memcpy(dir->names + dir->namesLen, dirent->name, nameLen);
+    dir->names[dir->namesLen + nameLen] = '\0';
+    dir->namesLen += nameLen + 1;
+    return true;
+}
+
+// read the whole listing, keeping the buffers of the previous one
+static uint8_t enumerate(dircache_Dir *dir)
+{
+    dir->count = 0;
+    dir->namesLen = 0;
+    dir->valid = false;
+
+    IODIR *handle = fs_openDir(dir->path);
+    if (handle == NULL)
+    {
+        db_log("Failed opening directory to cache");
+        return false;
+    }
+
+    uint8_t ok = true;
+    IODIRENT *dirent;
+    while (ok && (dirent = fs_readDir(handle)) != NULL)
+    {
+        if (strcmp(dirent->name, ".") == 0 || strcmp(dirent->name, "..") == 0)
+            continue;
+
+        ok = addEntry(dir, dirent);
+    }
+    fs_closeDir(handle);
+
+    if (!ok)
+    {
+        db_log("Failed allocating directory cache");
+        dir->count = 0;
+        dir->namesLen = 0;
+        return false;
+    }
+
+    _sortNames = dir->names;
+    qsort(dir->entries, dir->count, sizeof(dircache_Entry), compareEntries);
+
+    dir->valid = true;
+    return true;
+}
+
+uint8_t dircache_open(dircache_Dir *dir, const char *path)
+{
+    memset(dir, 0, sizeof(dircache_Dir));
+
+    if (strlen(path) >= DIRCACHE_PATH_LEN)
+    {
+        db_log("Directory cache path too long");
+        return false;
+    }
+
+    strcpy(dir->path, path);
+
+    // the device is the first path component
+    const char *device = path[0] == '/' ? path + 1 : path;
+    uint32_t deviceLen = 0;
+    while (device[deviceLen] != '\0' && device[deviceLen] != '/' && deviceLen < sizeof(dir->device) - 1)
+    {
+        dir->device[deviceLen] = device[deviceLen];
+        deviceLen++;
+    }
+
+    return enumerate(dir);
+}
+
+void dircache_free(dircache_Dir *dir)
+{
+    free(dir->entries);
+    free(dir->names);
+    dir->entries = NULL;
+    dir->names = NULL;
+    dir->count = 0;
+    dir->entriesCap = 0;
+    dir->namesLen = 0;
+    dir->namesCap = 0;
+    dir->valid = false;
+}
+
+void dircache_invalidate(dircache_Dir *dir)
+{
+    dir->valid = false;
+}
+
+uint8_t dircache_update(dircache_Dir *dir)
+{
+    if (dir->path[0] == '\0')
+        return false;
+
+    if (!fs_deviceExists(dir->device))
+    {
+        // drop the listing so a different card inserted later is enumerated
+        dir->count = 0;
+        dir->namesLen = 0;
+        dir->valid = false;
+        return false;
+    }
+
+    return dir->valid || enumerate(dir);
+}
+
+const char *dircache_name(const dircache_Dir *dir, const dircache_Entry *entry)
+{
+    return dir->names + entry->nameOffset;
+}
+
+// index of the first entry whose name doesn't compare below key within its first n characters
+static uint32_t lowerBound(const dircache_Dir *dir, const char *key, uint32_t n)
+{
+    uint32_t lo = 0;
+    uint32_t hi = dir->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncmp(dir->names + dir->entries[mid].nameOffset, key, n) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+const dircache_Entry *dircache_find(const dircache_Dir *dir, const char *name)
+{
+    uint32_t len = (uint32_t)strlen(name);
+    uint32_t i = lowerBound(dir, name, len + 1);
+    if (i < dir->count && dir->entries[i].nameLen == len && memcmp(dir->names + dir->entries[i].nameOffset, name, len) == 0)
+        return &dir->entries[i];
+
+    return NULL;
+}
+
+uint32_t dircache_findPrefix(const dircache_Dir *dir, const char *prefix, uint32_t *outCount)
+{
+    uint32_t len = (uint32_t)strlen(prefix);
+    uint32_t first = lowerBound(dir, prefix, len);
+
+    // names with the prefix compare equal over its length, so they end at the first entry that doesn't
+    uint32_t lo = first;
+    uint32_t hi = dir->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (strncmp(dir->names + dir->entries[mid].nameOffset, prefix, len) == 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *outCount = lo - first;
+    return first;
+}
@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "db_input.h"
+
+// history of each port, _frame indexes the current state
+static gamepad_State _history[INPUT_PORTS][INPUT_HISTORY];
+static uint32_t _frame = 0;
+
+// the latest read of every port, shared by input_update and the Koka gamepad module so the pads are read once per frame
+static gamepad_State _pads[INPUT_PORTS];
+static bool _padsPending = false;
+
+static uint8_t _connected[INPUT_PORTS];
+static uint32_t _readsUntilConnectCheck = 0;
+
+static int16_t _deadzones[INPUT_PORTS] = {INPUT_DEFAULT_DEADZONE, INPUT_DEFAULT_DEADZONE, INPUT_DEFAULT_DEADZONE, INPUT_DEFAULT_DEADZONE};
+
+static inline const gamepad_State *getState(uint32_t port, uint32_t framesAgo)
+{
+    return &_history[port][(_frame - framesAgo) & (INPUT_HISTORY - 1)];
+}
+
+static void applyDeadzone(int16_t *x, int16_t *y, int16_t deadzone)
+{
+    float fx = *x;
+    float fy = *y;
+    float len = sqrtf(fx * fx + fy * fy);
+    if (len <= deadzone)
+    {
+        *x = 0;
+        *y = 0;
+        return;
+    }
+
+    float scale = (len > 32767.0f ? 32767.0f - deadzone : len - deadzone) / (32767.0f - deadzone) * 32767.0f / len;
+    *x = (int16_t)(fx * scale);
+    *y = (int16_t)(fy * scale);
+}
+
+void input_readPads()
+{
+    if (_readsUntilConnectCheck == 0)
+    {
+        for (uint32_t port = 0; port < INPUT_PORTS; port++)
+        {
+            _connected[port] = gamepad_isConnected(port);
+        }
+        _readsUntilConnectCheck = INPUT_CONNECT_INTERVAL;
+    }
+    _readsUntilConnectCheck--;
+
+    for (uint32_t port = 0; port < INPUT_PORTS; port++)
+    {
+        if (_connected[port])
+            gamepad_readState(port, &_pads[port]);
+        else
+            memset(&_pads[port], 0, sizeof(gamepad_State));
+    }
+
+    _padsPending = true;
+}
+
+void input_update()
+{
+    // reuse the pads if they were already read since the last update
+    if (!_padsPending)
+        input_readPads();
+    _padsPending = false;
+
+    _frame++;
+    for (uint32_t port = 0; port < INPUT_PORTS; port++)
+    {
+        gamepad_State *state = &_history[port][_frame & (INPUT_HISTORY - 1)];
+        *state = _pads[port];
+
+        if (_deadzones[port] > 0)
+        {
+            applyDeadzone(&state->lStickX, &state->lStickY, _deadzones[port]);
+            applyDeadzone(&state->rStickX, &state->rStickY, _deadzones[port]);
+        }
+    }
+}
+
+void input_setDeadzone(uint32_t port, int16_t deadzone)
+{
+    if (port < INPUT_PORTS)
+        _deadzones[port] = deadzone < 0 ? 0 : (deadzone > 32766 ? 32766 : deadzone);
+}
+
+uint8_t input_isConnected(uint32_t port)
+{
+    return port < INPUT_PORTS && _connected[port];
+}
+
+uint16_t input_held(uint32_t port)
+{
+    return port < INPUT_PORTS ? getState(port, 0)->btnMask : 0;
+}
+
+uint16_t input_pressed(uint32_t port)
+{
+    if (port >= INPUT_PORTS)
+        return 0;
+
+    return getState(port, 0)->btnMask & ~getState(port, 1)->btnMask;
+}
+
+uint16_t input_released(uint32_t port)
+{
+    if (port >= INPUT_PORTS)
+        return 0;
+
+    return getState(port, 1)->btnMask & ~getState(port, 0)->btnMask;
+}
+
+uint16_t input_pressedWithin(uint32_t port, uint16_t mask, uint32_t framesAgo, uint32_t frames)
+{
+    // the oldest frame needs the one before it to tell if a button went down
+    if (port >= INPUT_PORTS || framesAgo >= INPUT_HISTORY - 1)
+        return 0;
+
+    if (frames > INPUT_HISTORY - 1 - framesAgo)
+        frames = INPUT_HISTORY - 1 - framesAgo;
+
+    uint16_t pressed = 0;
+    for (uint32_t i = framesAgo; i < framesAgo + frames; i++)
+    {
+        pressed |= getState(port, i)->btnMask & ~getState(port, i + 1)->btnMask;
+    }
+
+    return pressed & mask;
+}
+
+const gamepad_State *input_padState(uint32_t port)
+{
+    return port < INPUT_PORTS ? &_pads[port] : NULL;
+}
+
+const gamepad_State *input_state(uint32_t port, uint32_t framesAgo)
+{
+    if (port >= INPUT_PORTS || framesAgo >= INPUT_HISTORY)
+        return NULL;
+
+    return getState(port, framesAgo);
+}
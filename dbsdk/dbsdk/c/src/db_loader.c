@@ -0,0 +1,303 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_loader.h"
+#include "db_audio.h"
+#include "db_io.h"
+#include "db_log.h"
+#include "db_vdp.h"
+
+typedef struct
+{
+    uint8_t state;
+    uint8_t upload;
+    uint8_t priority;
+    uint8_t stereoMode;
+    uint32_t generation;
+    uint32_t sequence;
+    uint32_t textureFormat;
+    uint32_t textureWidth;
+    uint32_t textureHeight;
+    loader_Callback callback;
+    void *userData;
+    IOFILE *file;
+    uint8_t *data;
+    uint32_t size;
+    uint32_t read;
+    char path[LOADER_PATH_LEN];
+} loadRequest;
+
+static loadRequest _requests[LOADER_MAX_REQUESTS];
+static uint32_t _nextSequence = 0;
+static uint32_t _frameBytes = LOADER_DEFAULT_FRAME_BYTES;
+static float _frameMs = 0.0f;
+
+// handles pack the request slot into the low 8 bits and its generation into the rest, like voice handles
+static inline loader_handle makeHandle(const loadRequest *request)
+{
+    return (request->generation << 8) | (uint32_t)(request - _requests);
+}
+
+// get the pending request a handle refers to, or NULL if it has completed or been cancelled since
+static loadRequest *getRequest(loader_handle handle)
+{
+    if (handle == LOADER_INVALID_HANDLE || (handle & 0xFF) >= LOADER_MAX_REQUESTS)
+        return NULL;
+
+    loadRequest *request = &_requests[handle & 0xFF];
+    if (request->state == LOADER_STATE_INVALID || request->generation != (handle >> 8))
+        return NULL;
+
+    return request;
+}
+
+// release everything the request holds + free its slot
+static void releaseRequest(loadRequest *request)
+{
+    if (request->file != NULL)
+        fs_close(request->file);
+
+    free(request->data);
+    request->file = NULL;
+    request->data = NULL;
+    request->state = LOADER_STATE_INVALID;
+    request->generation = (request->generation + 1) & 0xFFFFFF;
+}
+
+static loader_handle queueRequest(const char *path, uint8_t priority, uint8_t upload, loader_Callback callback, void *userData, loadRequest **outRequest)
+{
+    if (strlen(path) >= LOADER_PATH_LEN)
+    {
+        db_log("Load request path too long");
+        return LOADER_INVALID_HANDLE;
+    }
+
+    for (int i = 0; i < LOADER_MAX_REQUESTS; i++)
+    {
+        loadRequest *request = &_requests[i];
+        if (request->state != LOADER_STATE_INVALID)
+            continue;
+
+        strcpy(request->path, path);
+        request->state = LOADER_STATE_QUEUED;
+        request->upload = upload;
+        request->priority = priority;
+        request->sequence = _nextSequence++;
+        request->callback = callback;
+        request->userData = userData;
+        request->size = 0;
+        request->read = 0;
+        *outRequest = request;
+        return makeHandle(request);
+    }
+
+    db_log("Too many pending load requests");
+    return LOADER_INVALID_HANDLE;
+}
+
+void loader_setBudget(uint32_t frameBytes, float frameMs)
+{
+    _frameBytes = frameBytes;
+    _frameMs = frameMs;
+}
+
+loader_handle loader_load(const char *path, uint8_t priority, loader_Callback callback, void *userData)
+{
+    loadRequest *request;
+    return queueRequest(path, priority, LOADER_UPLOAD_NONE, callback, userData, &request);
+}
+
+loader_handle loader_loadTexture(const char *path, uint8_t priority, uint32_t format, uint32_t width, uint32_t height, loader_Callback callback, void *userData)
+{
+    loadRequest *request;
+    loader_handle handle = queueRequest(path, priority, LOADER_UPLOAD_TEXTURE, callback, userData, &request);
+    if (handle != LOADER_INVALID_HANDLE)
+    {
+        request->textureFormat = format;
+        request->textureWidth = width;
+        request->textureHeight = height;
+    }
+
+    return handle;
+}
+
+loader_handle loader_loadSample(const char *path, uint8_t priority, uint8_t stereoMode, loader_Callback callback, void *userData)
+{
+    loadRequest *request;
+    loader_handle handle = queueRequest(path, priority, LOADER_UPLOAD_SAMPLE, callback, userData, &request);
+    if (handle != LOADER_INVALID_HANDLE)
+        request->stereoMode = stereoMode;
+
+    return handle;
+}
+
+void loader_cancel(loader_handle handle)
+{
+    loadRequest *request = getRequest(handle);
+    if (request != NULL)
+        releaseRequest(request);
+}
+
+uint8_t loader_getState(loader_handle handle)
+{
+    loadRequest *request = getRequest(handle);
+    return request != NULL ? request->state : LOADER_STATE_INVALID;
+}
+
+float loader_progress(loader_handle handle)
+{
+    loadRequest *request = getRequest(handle);
+    if (request == NULL || request->size == 0)
+        return 0.0f;
+
+    return (float)request->read / (float)request->size;
+}
+
+uint32_t loader_pendingCount()
+{
+    uint32_t count = 0;
+    for (int i = 0; i < LOADER_MAX_REQUESTS; i++)
+    {
+        if (_requests[i].state != LOADER_STATE_INVALID)
+            count++;
+    }
+
+    return count;
+}
+
+// highest priority first, then oldest first. a higher priority request queued mid-load takes over the next read,
+// the interrupted request keeps its file open + resumes later
+static loadRequest *nextRequest()
+{
+    loadRequest *best = NULL;
+    for (int i = 0; i < LOADER_MAX_REQUESTS; i++)
+    {
+        loadRequest *request = &_requests[i];
+        if (request->state == LOADER_STATE_INVALID)
+            continue;
+
+        if (best == NULL || request->priority > best->priority ||
+            (request->priority == best->priority && (int32_t)(request->sequence - best->sequence) < 0))
+            best = request;
+    }
+
+    return best;
+}
+
+// open the file + allocate its buffer
+static uint8_t startRequest(loadRequest *request)
+{
+    request->file = fs_open(request->path, IO_FILEMODE_READ);
+    if (request->file == NULL)
+    {
+        db_log("Failed opening file to load");
+        return false;
+    }
+
+    fs_seek(request->file, 0, IO_WHENCE_END);
+    request->size = fs_tell(request->file);
+    fs_seek(request->file, 0, IO_WHENCE_BEGIN);
+
+    // allocate at least a byte so empty files still produce a valid buffer
+    request->data = malloc(request->size > 0 ? request->size : 1);
+    if (request->data == NULL)
+    {
+        db_log("Failed allocating load buffer");
+        return false;
+    }
+
+    request->state = LOADER_STATE_LOADING;
+    return true;
+}
+
+// upload the finished request + hand the result to its callback. the slot is freed first so the callback can queue
+// new requests
+static void completeRequest(loadRequest *request, uint8_t state)
+{
+    loader_Result result = {.state = state, .size = request->size, .texture = (uint32_t)-1, .sample = {.handle = -1, .handleRight = -1}};
+    loader_handle handle = makeHandle(request);
+    loader_Callback callback = request->callback;
+    void *userData = request->userData;
+
+    if (request->file != NULL)
+    {
+        fs_close(request->file);
+        request->file = NULL;
+    }
+
+    if (state == LOADER_STATE_DONE)
+    {
+        switch (request->upload)
+        {
+        case LOADER_UPLOAD_NONE:
+            // ownership passes to the callback
+            result.data = request->data;
+            request->data = NULL;
+            break;
+        case LOADER_UPLOAD_TEXTURE:
+            result.texture = vdp_allocTexture(false, request->textureFormat, request->textureWidth, request->textureHeight);
+            if (result.texture == (uint32_t)-1)
+            {
+                db_log("Failed allocating texture for load request");
+                result.state = LOADER_STATE_FAILED;
+                break;
+            }
+            vdp_setTextureData(result.texture, 0, request->data, request->size);
+            break;
+        case LOADER_UPLOAD_SAMPLE:
+            result.sample = sound_loadWavBytesLen(request->data, request->size, request->stereoMode);
+            if (result.sample.handle == -1)
+                result.state = LOADER_STATE_FAILED;
+            break;
+        }
+    }
+
+    releaseRequest(request);
+
+    if (callback != NULL)
+        callback(handle, &result, userData);
+    else
+        free(result.data);
+}
+
+void loader_update()
+{
+    uint32_t bytesLeft = _frameBytes;
+    double deadline = _frameMs > 0.0f ? audio_getTime() + _frameMs / 1000.0 : 0.0;
+
+    while (bytesLeft > 0)
+    {
+        loadRequest *request = nextRequest();
+        if (request == NULL)
+            break;
+
+        if (request->state == LOADER_STATE_QUEUED && !startRequest(request))
+        {
+            completeRequest(request, LOADER_STATE_FAILED);
+            continue;
+        }
+
+        // each request gets a single host read per frame, as large as the budget allows
+        uint32_t len = request->size - request->read;
+        if (len > bytesLeft)
+            len = bytesLeft;
+
+        uint32_t read = len > 0 ? fs_read(request->file, request->data + request->read, len) : 0;
+        request->read += read;
+        bytesLeft -= read;
+
+        if (read < len)
+        {
+            db_log("File truncated while loading");
+            completeRequest(request, LOADER_STATE_FAILED);
+        }
+        else if (request->read == request->size)
+        {
+            completeRequest(request, LOADER_STATE_DONE);
+        }
+
+        if (deadline > 0.0 && audio_getTime() >= deadline)
+            break;
+    }
+}
@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "db_lz4.h"
+
+// copies are done in 8 byte words where there's room to overshoot, which is most of a block
+#define WILDCOPY_SLACK 8
+
+static inline void copy8(uint8_t *dst, const uint8_t *src)
+{
+    uint64_t w;
+    memcpy(&w, src, 8);
+    memcpy(dst, &w, 8);
+}
+
+// read an LZ4 length continuation (a run of 255s ended by a smaller byte), returning false if the input ends first
+static inline int readLength(const uint8_t **ip, const uint8_t *iend, uint32_t *len)
+{
+    uint8_t b;
+    do
+    {
+        if (*ip >= iend)
+            return 0;
+
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+
+    return 1;
+}
+
+int32_t lz4_decompressBlock(const uint8_t *src, uint32_t srcLen, uint8_t *dst, uint32_t dstCap)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + srcLen;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dstCap;
+
+    while (ip < iend)
+    {
+        uint8_t token = *ip++;
+
+        // literals
+        uint32_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(&ip, iend, &litLen))
+            return -1;
+
+        if (litLen > (uint32_t)(iend - ip) || litLen > (uint32_t)(oend - op))
+            return -1;
+
+        if ((uint32_t)(iend - ip) >= litLen + WILDCOPY_SLACK && (uint32_t)(oend - op) >= litLen + WILDCOPY_SLACK)
+        {
+            for (uint32_t i = 0; i < litLen; i += 8)
+                copy8(op + i, ip + i);
+        }
+        else
+        {
+            memcpy(op, ip, litLen);
+        }
+        ip += litLen;
+        op += litLen;
+
+        // the last sequence of a block is literals only
+        if (ip == iend)
+            break;
+
+        // match
+        if (iend - ip < 2)
+            return -1;
+
+        uint32_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst))
+            return -1;
+
+        uint32_t matchLen = (token & 15) + 4;
+        if ((token & 15) == 15 && !readLength(&ip, iend, &matchLen))
+            return -1;
+
+        if (matchLen > (uint32_t)(oend - op))
+            return -1;
+
+        const uint8_t *match = op - offset;
+        if (offset >= 8 && (uint32_t)(oend - op) >= matchLen + WILDCOPY_SLACK)
+        {
+            // 8 byte steps never read bytes this match hasn't written yet once offset >= 8
+            for (uint32_t i = 0; i < matchLen; i += 8)
+                copy8(op + i, match + i);
+        }
+        else
+        {
+            // overlapping matches repeat the last offset bytes, so have to be copied a byte at a time
+            for (uint32_t i = 0; i < matchLen; i++)
+                op[i] = match[i];
+        }
+        op += matchLen;
+    }
+
+    return (int32_t)(op - dst);
+}
@@ -0,0 +1,287 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_music.h"
+#include "db_audio.h"
+#include "db_io.h"
+#include "db_log.h"
+
+#define MIDI_PATH_LEN 64
+
+typedef struct
+{
+    char path[MIDI_PATH_LEN];
+    uint8_t *data;
+    uint32_t dataLen;
+    uint32_t lastUsed;
+} cachedMidi;
+
+static uint8_t _state = MUSIC_STATE_IDLE;
+
+// soundfont load in progress
+static IOFILE *_sf2File = NULL;
+static uint8_t *_sf2Data = NULL;
+static uint32_t _sf2Len = 0;
+static uint32_t _sf2Read = 0;
+
+// soundfont the synth was initialized with. it stays allocated in case the synth references it, until a new soundfont
+// has replaced it. non-NULL while a synth is live, including while a replacement soundfont loads
+static uint8_t *_synthData = NULL;
+
+// playback requested before the synth was ready. only the latest request matters, since playing replaces the current song
+static void *_pendingMidi = NULL;
+static uint32_t _pendingMidiLen = 0;
+static uint8_t _pendingLoop = false;
+static float _pendingVolume = 1.0f;
+static uint8_t _pendingVolumeSet = false;
+static uint8_t _pendingReverb = false;
+static uint8_t _pendingReverbSet = false;
+
+static cachedMidi _midiCache[MUSIC_MAX_CACHED_MIDI];
+static uint32_t _midiUseCounter = 0;
+static const void *_playingMidi = NULL;
+
+// a failed load leaves the previous synth (if any) playing
+static void loadFailed()
+{
+    _state = _synthData != NULL ? MUSIC_STATE_READY : MUSIC_STATE_ERROR;
+}
+
+uint8_t music_beginLoadSoundfont(const char *path)
+{
+    if (_state == MUSIC_STATE_LOADING)
+    {
+        db_log("Soundfont is already loading");
+        return false;
+    }
+
+    IOFILE *file = fs_open(path, IO_FILEMODE_READ);
+    if (file == NULL)
+    {
+        db_log("Failed opening soundfont");
+        loadFailed();
+        return false;
+    }
+
+    fs_seek(file, 0, IO_WHENCE_END);
+    uint32_t len = fs_tell(file);
+    fs_seek(file, 0, IO_WHENCE_BEGIN);
+
+    uint8_t *data = malloc(len);
+    if (data == NULL)
+    {
+        db_log("Failed allocating soundfont buffer");
+        fs_close(file);
+        loadFailed();
+        return false;
+    }
+
+    _sf2File = file;
+    _sf2Data = data;
+    _sf2Len = len;
+    _sf2Read = 0;
+    _state = MUSIC_STATE_LOADING;
+    return true;
+}
+
+// apply everything requested while the soundfont was loading
+static void flushPending()
+{
+    if (_pendingVolumeSet)
+        audio_setMidiVolume(_pendingVolume);
+    if (_pendingReverbSet)
+        audio_setMidiReverb(_pendingReverb);
+
+    if (_pendingMidi != NULL && !audio_playMidi(_pendingMidi, _pendingMidiLen, _pendingLoop))
+        db_log("Failed playing queued MIDI");
+
+    _pendingMidi = NULL;
+    _pendingVolumeSet = false;
+    _pendingReverbSet = false;
+}
+
+void music_update()
+{
+    if (_state != MUSIC_STATE_LOADING)
+        return;
+
+    uint32_t len = _sf2Len - _sf2Read;
+    if (len > MUSIC_LOAD_CHUNK_SIZE)
+        len = MUSIC_LOAD_CHUNK_SIZE;
+
+    uint32_t read = fs_read(_sf2File, _sf2Data + _sf2Read, len);
+    _sf2Read += read;
+
+    if (read < len)
+    {
+        db_log("Soundfont file truncated");
+        fs_close(_sf2File);
+        _sf2File = NULL;
+        free(_sf2Data);
+        _sf2Data = NULL;
+        loadFailed();
+        return;
+    }
+
+    if (_sf2Read < _sf2Len)
+        return;
+
+    fs_close(_sf2File);
+    _sf2File = NULL;
+
+    if (!audio_initSynth(_sf2Data, _sf2Len))
+    {
+        db_log("Failed initializing synth");
+        free(_sf2Data);
+        _sf2Data = NULL;
+        loadFailed();
+        return;
+    }
+
+    free(_synthData);
+    _synthData = _sf2Data;
+    _sf2Data = NULL;
+
+    _state = MUSIC_STATE_READY;
+    flushPending();
+}
+
+uint8_t music_getState()
+{
+    return _state;
+}
+
+float music_loadProgress()
+{
+    if (_state == MUSIC_STATE_READY)
+        return 1.0f;
+    if (_sf2Len == 0)
+        return 0.0f;
+
+    return (float)_sf2Read / (float)_sf2Len;
+}
+
+uint8_t music_playMidiBytes(void *smfData, uint32_t smfDataLen, uint8_t loop)
+{
+    if (_synthData != NULL)
+    {
+        _playingMidi = smfData;
+        return audio_playMidi(smfData, smfDataLen, loop);
+    }
+
+    if (_state != MUSIC_STATE_LOADING)
+    {
+        db_log("Synth not initialized, call music_beginLoadSoundfont first");
+        return false;
+    }
+
+    _playingMidi = smfData;
+    _pendingMidi = smfData;
+    _pendingMidiLen = smfDataLen;
+    _pendingLoop = loop;
+    return true;
+}
+
+// find a cached MIDI file, or read it into the least recently used cache slot which isn't playing
+static cachedMidi *getCachedMidi(const char *path)
+{
+    if (strlen(path) >= MIDI_PATH_LEN)
+    {
+        db_log("MIDI path too long to cache");
+        return NULL;
+    }
+
+    cachedMidi *slot = NULL;
+    for (int i = 0; i < MUSIC_MAX_CACHED_MIDI; i++)
+    {
+        cachedMidi *entry = &_midiCache[i];
+        if (entry->data != NULL && strcmp(entry->path, path) == 0)
+        {
+            entry->lastUsed = ++_midiUseCounter;
+            return entry;
+        }
+
+        if (entry->data == _playingMidi && entry->data != NULL)
+            continue;
+
+        if (slot == NULL || entry->lastUsed < slot->lastUsed)
+            slot = entry;
+    }
+
+    if (slot == NULL)
+        return NULL;
+
+    IOFILE *file = fs_open(path, IO_FILEMODE_READ);
+    if (file == NULL)
+    {
+        db_log("Failed opening MIDI file");
+        return NULL;
+    }
+
+    fs_seek(file, 0, IO_WHENCE_END);
+    uint32_t len = fs_tell(file);
+    fs_seek(file, 0, IO_WHENCE_BEGIN);
+
+    uint8_t *data = malloc(len);
+    if (data == NULL || fs_read(file, data, len) < len)
+    {
+        db_log("Failed reading MIDI file");
+        free(data);
+        fs_close(file);
+        return NULL;
+    }
+    fs_close(file);
+
+    free(slot->data);
+    strcpy(slot->path, path);
+    slot->data = data;
+    slot->dataLen = len;
+    slot->lastUsed = ++_midiUseCounter;
+    return slot;
+}
+
+uint8_t music_playMidi(const char *path, uint8_t loop)
+{
+    cachedMidi *midi = getCachedMidi(path);
+    if (midi == NULL)
+        return false;
+
+    return music_playMidiBytes(midi->data, midi->dataLen, loop);
+}
+
+void music_setVolume(float volume)
+{
+    if (_synthData != NULL)
+    {
+        audio_setMidiVolume(volume);
+        return;
+    }
+
+    _pendingVolume = volume;
+    _pendingVolumeSet = true;
+}
+
+void music_setReverb(uint8_t enabled)
+{
+    if (_synthData != NULL)
+    {
+        audio_setMidiReverb(enabled);
+        return;
+    }
+
+    _pendingReverb = enabled;
+    _pendingReverbSet = true;
+}
+
+void music_clearCache()
+{
+    for (int i = 0; i < MUSIC_MAX_CACHED_MIDI; i++)
+    {
+        free(_midiCache[i].data);
+        _midiCache[i].data = NULL;
+        _midiCache[i].lastUsed = 0;
+    }
+
+    _playingMidi = NULL;
+}
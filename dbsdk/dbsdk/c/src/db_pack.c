@@ -0,0 +1,235 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_pack.h"
+#include "db_lz4.h"
+#include "db_log.h"
+
+uint64_t pack_hashName(const char *name)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (const uint8_t *c = (const uint8_t *)name; *c != '\0'; c++)
+    {
+        h ^= *c;
+        h *= 0x100000001B3ull;
+    }
+
+    return h;
+}
+
+uint8_t pack_open(pack_File *pack, const char *path)
+{
+    pack->index = NULL;
+    pack->file = fs_open(path, IO_FILEMODE_READ);
+    if (pack->file == NULL)
+    {
+        db_log("Failed opening pack file");
+        return false;
+    }
+
+    pack_Header *header = &pack->header;
+    if (fs_read(pack->file, header, sizeof(pack_Header)) < sizeof(pack_Header) ||
+        strncmp(header->magic, PACK_MAGIC, 4) || header->version != PACK_VERSION)
+    {
+        db_log("Input is not a valid pack file");
+        fs_close(pack->file);
+        return false;
+    }
+
+    // the index must describe exactly the buckets + entries + names, with a power of two bucket count
+    uint64_t expected = (uint64_t)header->bucketCount * sizeof(uint32_t) + (uint64_t)header->entryCount * sizeof(pack_Entry) + header->namesSize;
+    if (header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0 ||
+        header->bucketCount <= header->entryCount || expected != header->indexSize)
+    {
+        db_log("Pack index is malformed");
+        fs_close(pack->file);
+        return false;
+    }
+
+    pack->index = malloc(header->indexSize);
+    if (pack->index == NULL)
+    {
+        db_log("Failed allocating pack index");
+        fs_close(pack->file);
+        return false;
+    }
+
+    if (fs_read(pack->file, pack->index, header->indexSize) < header->indexSize)
+    {
+        db_log("Pack file truncated");
+        pack_close(pack);
+        return false;
+    }
+
+    pack->buckets = (const uint32_t *)pack->index;
+    pack->entries = (const pack_Entry *)(pack->index + header->bucketCount * sizeof(uint32_t));
+    pack->names = (const char *)(pack->entries + header->entryCount);
+    pack->position = sizeof(pack_Header) + header->indexSize;
+
+    // names are compared with strcmp, so the table has to end in a terminator
+    if (header->namesSize > 0 && pack->names[header->namesSize - 1] != '\0')
+    {
+        db_log("Pack index is malformed");
+        pack_close(pack);
+        return false;
+    }
+
+    return true;
+}
+
+void pack_close(pack_File *pack)
+{
+    if (pack->file != NULL)
+        fs_close(pack->file);
+
+    free(pack->index);
+    pack->file = NULL;
+    pack->index = NULL;
+}
+
+const pack_Entry *pack_find(const pack_File *pack, const char *name)
+{
+    uint64_t hash = pack_hashName(name);
+    uint32_t mask = pack->header.bucketCount - 1;
+
+    // a valid table is never full, so probing ends at an empty bucket. a corrupt one may have none, so the probe is also
+    // bounded by the bucket count
+    uint32_t i = (uint32_t)hash & mask;
+    for (uint32_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask)
+    {
+        uint32_t idx = pack->buckets[i];
+        if (idx == PACK_EMPTY_BUCKET || idx >= pack->header.entryCount)
+            return NULL;
+
+        const pack_Entry *entry = &pack->entries[idx];
+        if (entry->hash == hash && entry->nameOffset < pack->header.namesSize &&
+            strcmp(pack->names + entry->nameOffset, name) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+const char *pack_entryName(const pack_File *pack, const pack_Entry *entry)
+{
+    if (entry->nameOffset >= pack->header.namesSize)
+        return NULL;
+
+    return pack->names + entry->nameOffset;
+}
+
+uint32_t pack_read(pack_File *pack, const pack_Entry *entry, uint32_t offset, void *dst, uint32_t len)
+{
+    uint32_t storedSize = entry->compressedSize != 0 ? entry->compressedSize : entry->size;
+    if (offset >= storedSize)
+        return 0;
+    if (len > storedSize - offset)
+        len = storedSize - offset;
+
+    uint32_t position = entry->offset + offset;
+    if (position != pack->position)
+        fs_seek(pack->file, position, IO_WHENCE_BEGIN);
+
+    uint32_t read = fs_read(pack->file, dst, len);
+    pack->position = position + read;
+    return read;
+}
+
+uint8_t pack_extract(pack_File *pack, const pack_Entry *entry, void *dst, uint8_t *scratch)
+{
+    if (entry->compressedSize == 0)
+        return pack_read(pack, entry, 0, dst, entry->size) == entry->size;
+
+    uint8_t *out = dst;
+    uint32_t pos = 0;
+    uint32_t written = 0;
+
+    uint32_t blockHeader;
+    if (pack_read(pack, entry, pos, &blockHeader, sizeof(blockHeader)) < sizeof(blockHeader))
+        blockHeader = 0;
+    pos += sizeof(blockHeader);
+
+    // blocks are read in order, so every read continues where the last one ended + needs no seek. compressed blocks
+    // are read together with the header of the block after them, one host call per block
+    while (written < entry->size && blockHeader != 0)
+    {
+        uint32_t blockLen = blockHeader & ~PACK_BLOCK_RAW;
+        uint32_t expected = entry->size - written < PACK_BLOCK_SIZE ? entry->size - written : PACK_BLOCK_SIZE;
+        uint32_t nextHeader = written + expected < entry->size ? sizeof(uint32_t) : 0;
+
+        if (blockHeader & PACK_BLOCK_RAW)
+        {
+            // raw blocks go straight into the destination
+            if (blockLen != expected || pack_read(pack, entry, pos, out + written, blockLen) < blockLen)
+                break;
+
+            blockHeader = 0;
+            if (nextHeader && pack_read(pack, entry, pos + blockLen, &blockHeader, sizeof(blockHeader)) < nextHeader)
+                break;
+        }
+        else
+        {
+            uint32_t readLen = blockLen + nextHeader;
+            if (blockLen > PACK_BLOCK_SIZE || pack_read(pack, entry, pos, scratch, readLen) < readLen ||
+                lz4_decompressBlock(scratch, blockLen, out + written, expected) != (int32_t)expected)
+                break;
+
+            blockHeader = 0;
+            if (nextHeader)
+                memcpy(&blockHeader, scratch + blockLen, sizeof(blockHeader));
+        }
+
+        pos += blockLen + nextHeader;
+        written += expected;
+    }
+
+    if (written < entry->size)
+    {
+        db_log("Pack asset corrupt or truncated");
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t *pack_load(pack_File *pack, const char *name, uint32_t *outSize)
+{
+    const pack_Entry *entry = pack_find(pack, name);
+    if (entry == NULL)
+        return NULL;
+
+    // allocate at least a byte so empty assets still return a valid pointer
+    uint8_t *data = malloc(entry->size > 0 ? entry->size : 1);
+    if (data == NULL)
+    {
+        db_log("Failed allocating pack asset buffer");
+        return NULL;
+    }
+
+    uint8_t *scratch = NULL;
+    if (entry->compressedSize != 0)
+    {
+        scratch = malloc(PACK_SCRATCH_SIZE);
+        if (scratch == NULL)
+        {
+            db_log("Failed allocating pack scratch buffer");
+            free(data);
+            return NULL;
+        }
+    }
+
+    uint8_t ok = pack_extract(pack, entry, data, scratch);
+    free(scratch);
+
+    if (!ok)
+    {
+        free(data);
+        return NULL;
+    }
+
+    if (outSize != NULL)
+        *outSize = entry->size;
+
+    return data;
+}
@@ -0,0 +1,377 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_save.h"
+#include "db_log.h"
+
+static uint32_t _crcTable[256];
+static uint8_t _crcTableReady = false;
+
+static void initCrcTable()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        _crcTable[i] = c;
+    }
+
+    _crcTableReady = true;
+}
+
+uint32_t save_crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    if (!_crcTableReady)
+        initCrcTable();
+
+    const uint8_t *p = data;
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc = _crcTable[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+static inline uint32_t blocksFor(uint32_t size)
+{
+    return (size + SAVE_BLOCK_SIZE - 1) / SAVE_BLOCK_SIZE;
+}
+
+static inline uint32_t headerBlocksFor(uint32_t capacity)
+{
+    return blocksFor(sizeof(save_Header) + capacity * sizeof(save_BlockInfo));
+}
+
+static inline save_Header *getHeader(const save_File *save, uint32_t copy)
+{
+    return (save_Header *)save->headers[copy];
+}
+
+static inline save_BlockInfo *getBlocks(const save_File *save, uint32_t copy)
+{
+    return (save_BlockInfo *)(save->headers[copy] + sizeof(save_Header));
+}
+
+// file offset of a data block in the given region
+static inline uint32_t blockOffset(const save_File *save, uint32_t block, uint32_t region)
+{
+    return (2 * save->headerBlocks + region * save->capacity + block) * SAVE_BLOCK_SIZE;
+}
+
+static uint32_t headerCrc(const save_File *save, uint32_t copy)
+{
+    save_Header *header = getHeader(save, copy);
+    uint32_t stored = header->headerCrc;
+    header->headerCrc = 0;
+    uint32_t crc = save_crc32(0, save->headers[copy], save->headerBlocks * SAVE_BLOCK_SIZE);
+    header->headerCrc = stored;
+    return crc;
+}
+
+static uint8_t isHeaderValid(const save_File *save, uint32_t copy)
+{
+    const save_Header *header = getHeader(save, copy);
+    return strncmp(header->magic, SAVE_MAGIC, 4) == 0 && header->version == SAVE_VERSION &&
+           header->capacity == save->capacity && header->dataSize <= save->capacity * SAVE_BLOCK_SIZE &&
+           header->headerCrc == headerCrc(save, copy);
+}
+
+// set up the layout + allocate both header copies
+static uint8_t initSave(save_File *save, const char *path, uint32_t maxDataSize)
+{
+    save->headers[0] = NULL;
+    save->headers[1] = NULL;
+
+    if (strlen(path) >= SAVE_PATH_LEN)
+    {
+        db_log("Save path too long");
+        return false;
+    }
+
+    strcpy(save->path, path);
+    save->capacity = blocksFor(maxDataSize);
+    save->headerBlocks = headerBlocksFor(save->capacity);
+    save->active = 0;
+
+    uint32_t headerSize = save->headerBlocks * SAVE_BLOCK_SIZE;
+    save->headers[0] = calloc(2, headerSize);
+    if (save->headers[0] == NULL)
+    {
+        db_log("Failed allocating save headers");
+        return false;
+    }
+
+    save->headers[1] = save->headers[0] + headerSize;
+    return true;
+}
+
+uint32_t save_fileBlocks(uint32_t maxDataSize)
+{
+    uint32_t capacity = blocksFor(maxDataSize);
+    return 2 * headerBlocksFor(capacity) + 2 * capacity;
+}
+
+uint8_t save_format(save_File *save, IOFILE *file, const char *path, uint32_t maxDataSize)
+{
+    if (!initSave(save, path, maxDataSize))
+        return false;
+
+    // copy 1 gets sequence 0 so copy 0 is current, both are valid
+    for (uint32_t copy = 0; copy < 2; copy++)
+    {
+        save_Header *header = getHeader(save, copy);
+        memcpy(header->magic, SAVE_MAGIC, 4);
+        header->version = SAVE_VERSION;
+        header->sequence = 1 - copy;
+        header->dataSize = 0;
+        header->capacity = save->capacity;
+        header->headerCrc = headerCrc(save, copy);
+    }
+
+    uint32_t len = 2 * save->headerBlocks * SAVE_BLOCK_SIZE;
+    fs_seek(file, 0, IO_WHENCE_BEGIN);
+    if (fs_write(file, save->headers[0], len) != len)
+    {
+        db_log("Failed writing save headers");
+        save_close(save);
+        return false;
+    }
+
+    fs_flush(file);
+    return true;
+}
+
+uint8_t save_open(save_File *save, const char *path, uint32_t maxDataSize)
+{
+    if (!initSave(save, path, maxDataSize))
+        return false;
+
+    IOFILE *file = fs_open(path, IO_FILEMODE_READ);
+    if (file == NULL)
+    {
+        db_log("Failed opening save file");
+        save_close(save);
+        return false;
+    }
+
+    // both copies are adjacent, read them in one go
+    uint32_t len = 2 * save->headerBlocks * SAVE_BLOCK_SIZE;
+    uint32_t read = fs_read(file, save->headers[0], len);
+    fs_close(file);
+
+    uint8_t valid0 = read == len && isHeaderValid(save, 0);
+    uint8_t valid1 = read == len && isHeaderValid(save, 1);
+    if (!valid0 && !valid1)
+    {
+        db_log("Save file has no valid header");
+        save_close(save);
+        return false;
+    }
+
+    if (valid0 && valid1)
+        save->active = (int32_t)(getHeader(save, 1)->sequence - getHeader(save, 0)->sequence) > 0 ? 1 : 0;
+    else
+        save->active = valid1 ? 1 : 0;
+
+    return true;
+}
+
+void save_close(save_File *save)
+{
+    // both copies share one allocation
+    free(save->headers[0]);
+    save->headers[0] = NULL;
+    save->headers[1] = NULL;
+}
+
+uint32_t save_dataSize(const save_File *save)
+{
+    return getHeader(save, save->active)->dataSize;
+}
+
+uint8_t save_read(save_File *save, void *dst, uint32_t dstLen)
+{
+    const save_Header *header = getHeader(save, save->active);
+    const save_BlockInfo *blocks = getBlocks(save, save->active);
+    uint32_t size = header->dataSize;
+    uint32_t count = blocksFor(size);
+    uint8_t *out = dst;
+
+    if (dstLen < size)
+    {
+        db_log("Save read buffer too small");
+        return false;
+    }
+
+    IOFILE *file = fs_open(save->path, IO_FILEMODE_READ);
+    if (file == NULL)
+    {
+        db_log("Failed opening save file");
+        return false;
+    }
+
+    uint8_t ok = true;
+    uint8_t last[SAVE_BLOCK_SIZE];
+
+    // blocks in the same region are read in contiguous runs, the partial last block goes through a padded buffer
+    for (uint32_t i = 0; i < count && ok;)
+    {
+        uint32_t end = i + 1;
+        while (end < count && blocks[end].region == blocks[i].region)
+        {
+            end++;
+        }
+
+        uint32_t fullEnd = end * SAVE_BLOCK_SIZE > size ? end - 1 : end;
+        fs_seek(file, blockOffset(save, i, blocks[i].region), IO_WHENCE_BEGIN);
+
+        uint32_t len = (fullEnd - i) * SAVE_BLOCK_SIZE;
+        if (len > 0 && fs_read(file, out + i * SAVE_BLOCK_SIZE, len) != len)
+            ok = false;
+
+        for (uint32_t b = i; b < fullEnd && ok; b++)
+        {
+            if (save_crc32(0, out + b * SAVE_BLOCK_SIZE, SAVE_BLOCK_SIZE) != blocks[b].crc)
+                ok = false;
+        }
+
+        if (ok && fullEnd < end)
+        {
+            uint32_t tail = size - fullEnd * SAVE_BLOCK_SIZE;
+            if (fs_read(file, last, SAVE_BLOCK_SIZE) != SAVE_BLOCK_SIZE ||
+                save_crc32(0, last, SAVE_BLOCK_SIZE) != blocks[fullEnd].crc)
+                ok = false;
+            else
+                memcpy(out + fullEnd * SAVE_BLOCK_SIZE, last, tail);
+        }
+
+        i = end;
+    }
+
+    fs_close(file);
+
+    if (!ok)
+        db_log("Save data corrupt or truncated");
+
+    return ok;
+}
+
+int32_t save_write(save_File *save, const void *data, uint32_t size)
+{
+    if (size > save->capacity * SAVE_BLOCK_SIZE)
+    {
+        db_log("Save data larger than the save file");
+        return -1;
+    }
+
+    const uint8_t *in = data;
+    uint32_t current = save->active;
+    uint32_t next = 1 - current;
+    uint32_t headerSize = save->headerBlocks * SAVE_BLOCK_SIZE;
+    uint32_t oldCount = blocksFor(getHeader(save, current)->dataSize);
+    uint32_t count = blocksFor(size);
+
+    // the new header is built in the older copy, which only becomes current once it is on the card
+    memcpy(save->headers[next], save->headers[current], headerSize);
+    save_Header *header = getHeader(save, next);
+    save_BlockInfo *blocks = getBlocks(save, next);
+    const save_BlockInfo *oldBlocks = getBlocks(save, current);
+    header->sequence++;
+    header->dataSize = size;
+
+    // find the changed blocks first, each moves to the region not holding its current contents
+    uint8_t last[SAVE_BLOCK_SIZE];
+    uint32_t tail = size % SAVE_BLOCK_SIZE;
+    if (tail != 0)
+    {
+        memcpy(last, in + (count - 1) * SAVE_BLOCK_SIZE, tail);
+        memset(last + tail, 0, SAVE_BLOCK_SIZE - tail);
+    }
+
+    uint32_t changed = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t *block = (tail != 0 && i == count - 1) ? last : in + i * SAVE_BLOCK_SIZE;
+        uint32_t crc = save_crc32(0, block, SAVE_BLOCK_SIZE);
+
+        if (i < oldCount && crc == oldBlocks[i].crc)
+        {
+            blocks[i].region = oldBlocks[i].region;
+        }
+        else
+        {
+            blocks[i].crc = crc;
+            blocks[i].region = 1 - oldBlocks[i].region;
+            changed++;
+        }
+    }
+
+    // nothing to do for an autosave of unchanged data
+    if (changed == 0 && size == getHeader(save, current)->dataSize)
+        return 0;
+
+    IOFILE *file = fs_open(save->path, IO_FILEMODE_WRITE);
+    if (file == NULL)
+    {
+        db_log("Failed opening save file for writing");
+        return -1;
+    }
+
+    uint8_t ok = true;
+
+    // write runs of changed blocks headed for the same region with one seek, the padded last block follows its run
+    for (uint32_t i = 0; i < count && ok;)
+    {
+        // changed blocks always switch region
+        if (blocks[i].region == oldBlocks[i].region)
+        {
+            i++;
+            continue;
+        }
+
+        uint32_t end = i + 1;
+        while (end < count && blocks[end].region != oldBlocks[end].region && blocks[end].region == blocks[i].region)
+        {
+            end++;
+        }
+
+        uint32_t fullEnd = (tail != 0 && end == count) ? end - 1 : end;
+        fs_seek(file, blockOffset(save, i, blocks[i].region), IO_WHENCE_BEGIN);
+
+        uint32_t len = (fullEnd - i) * SAVE_BLOCK_SIZE;
+        if (len > 0 && fs_write(file, in + i * SAVE_BLOCK_SIZE, len) != len)
+            ok = false;
+        if (ok && fullEnd < end && fs_write(file, last, SAVE_BLOCK_SIZE) != SAVE_BLOCK_SIZE)
+            ok = false;
+
+        i = end;
+    }
+
+    // the data has to be on the card before the header referencing it
+    if (ok)
+    {
+        fs_flush(file);
+
+        header->headerCrc = headerCrc(save, next);
+        fs_seek(file, next * headerSize, IO_WHENCE_BEGIN);
+        ok = fs_write(file, save->headers[next], headerSize) == headerSize;
+        fs_flush(file);
+    }
+
+    fs_close(file);
+
+    if (!ok)
+    {
+        db_log("Failed writing save data");
+        return -1;
+    }
+
+    save->active = next;
+    return (int32_t)changed;
+}
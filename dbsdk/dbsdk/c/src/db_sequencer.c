@@ -0,0 +1,254 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "db_audio.h"
+#include "db_sequencer.h"
+
+// ramps are expanded into steps, since voice params can only be set at a point in time
+#define RAMP_STEP_LENGTH 0.01f
+#define RAMP_MAX_STEPS 32
+
+// linked list of playing sequences
+static sequencer_Sequence *_activeSequences = NULL;
+
+static inline float clampf(float v, float min, float max)
+{
+    return v < min ? min : (v > max ? max : v);
+}
+
+// set a param on every voice of a channel. split stereo samples keep their channels hard panned left + right
+static void setChannelParam(sequencer_Channel *channel, uint32_t param, float value, double t)
+{
+    for (uint32_t i = 0; i < channel->numVoices; i++)
+    {
+        float voiceValue = value;
+        if (param == AUDIO_VOICEPARAM_PAN && channel->numVoices == 2)
+            voiceValue = clampf(value + (i == 0 ? -1.0f : 1.0f), -1.0f, 1.0f);
+
+        sound_setVoiceParamAt(channel->voices[i], param, voiceValue, t);
+    }
+
+    switch (param)
+    {
+    case AUDIO_VOICEPARAM_VOLUME:
+        channel->volume = value;
+        break;
+    case AUDIO_VOICEPARAM_PITCH:
+        channel->pitch = value;
+        break;
+    case AUDIO_VOICEPARAM_PAN:
+        channel->pan = value;
+        break;
+    }
+}
+
+static float getChannelParam(const sequencer_Channel *channel, uint32_t param, float fallback)
+{
+    switch (param)
+    {
+    case AUDIO_VOICEPARAM_VOLUME:
+        return channel->volume;
+    case AUDIO_VOICEPARAM_PITCH:
+        return channel->pitch;
+    case AUDIO_VOICEPARAM_PAN:
+        return channel->pan;
+    default:
+        return fallback;
+    }
+}
+
+// the params a channel tracks, events for any other param are skipped
+static inline bool isChannelParam(uint32_t param)
+{
+    return param == AUDIO_VOICEPARAM_VOLUME || param == AUDIO_VOICEPARAM_PITCH || param == AUDIO_VOICEPARAM_PAN;
+}
+
+static void stopChannel(sequencer_Channel *channel, double t)
+{
+    for (uint32_t i = 0; i < channel->numVoices; i++)
+        sound_stopVoiceAt(channel->voices[i], t);
+
+    channel->numVoices = 0;
+}
+
+static void scheduleEvent(sequencer_Sequence *sequence, const sequencer_Event *event, double t)
+{
+    if (event->channel >= SEQUENCER_MAX_CHANNELS)
+        return;
+
+    if ((event->type == SEQUENCER_EVENT_PARAM || event->type == SEQUENCER_EVENT_RAMP) && !isChannelParam(event->param))
+        return;
+
+    sequencer_Channel *channel = &sequence->channels[event->channel];
+
+    switch (event->type)
+    {
+    case SEQUENCER_EVENT_NOTE_ON:
+        stopChannel(channel, t);
+        channel->numVoices = sound_playOneShotAt(sequence->priority, event->sample, sequence->reverb, event->loop,
+                                                 event->value, event->pitch, event->pan, t, channel->voices);
+        channel->volume = event->value;
+        channel->pitch = event->pitch;
+        channel->pan = event->pan;
+        channel->lastStartTime = t;
+        break;
+    case SEQUENCER_EVENT_NOTE_OFF:
+        stopChannel(channel, t);
+        break;
+    case SEQUENCER_EVENT_PARAM:
+        setChannelParam(channel, event->param, event->value, t);
+        break;
+    case SEQUENCER_EVENT_RAMP:
+    {
+        float from = getChannelParam(channel, event->param, event->value);
+        uint32_t steps = (uint32_t)ceilf(event->duration / RAMP_STEP_LENGTH);
+        if (steps > RAMP_MAX_STEPS)
+            steps = RAMP_MAX_STEPS;
+        if (steps == 0)
+            steps = 1;
+
+        for (uint32_t i = 1; i <= steps; i++)
+        {
+            float f = (float)i / steps;
+            setChannelParam(channel, event->param, from + (event->value - from) * f, t + event->duration * f);
+        }
+        break;
+    }
+    }
+}
+
+// schedule the events of one sequence inside the lookahead window, returns false once a one-shot sequence has finished
+static bool updateSequence(sequencer_Sequence *sequence, double now)
+{
+    double windowEnd = now + sequence->lookahead;
+
+    while (true)
+    {
+        if (sequence->nextEvent >= sequence->numEvents)
+        {
+            if (sequence->loopLength <= 0.0)
+            {
+                // keep the sequence alive until its last event has played, so sequencer_stop can still cut it off
+                double endTime = sequence->startTime;
+                if (sequence->numEvents > 0)
+                {
+                    const sequencer_Event *last = &sequence->events[sequence->numEvents - 1];
+                    endTime += last->time + (last->type == SEQUENCER_EVENT_RAMP ? last->duration : 0.0f);
+                }
+                return now < endTime;
+            }
+
+            // wrap around to the next iteration of the loop
+            sequence->startTime += sequence->loopLength;
+            sequence->nextEvent = 0;
+
+            // after a stall, skip the iterations which have already ended rather than replaying all of them at once
+            if (sequence->startTime + sequence->loopLength <= now)
+                sequence->startTime += floor((now - sequence->startTime) / sequence->loopLength) * sequence->loopLength;
+
+            if (sequence->numEvents == 0 || sequence->startTime >= windowEnd)
+                return true;
+        }
+
+        const sequencer_Event *event = &sequence->events[sequence->nextEvent];
+        double eventTime = sequence->startTime + event->time;
+        if (eventTime >= windowEnd)
+            return true;
+
+        // events which were missed (e.g. after a long frame) still play, as soon as possible
+        scheduleEvent(sequence, event, eventTime > now ? eventTime : now);
+        sequence->nextEvent++;
+    }
+}
+
+void sequencer_init(sequencer_Sequence *sequence, const sequencer_Event *events, uint32_t numEvents, double loopLength, uint8_t priority)
+{
+    // very short loops would schedule a huge number of iterations per update
+    if (!(loopLength > 0.0 && isfinite(loopLength)))
+        loopLength = 0.0;
+    else if (loopLength < SEQUENCER_MIN_LOOP_LENGTH)
+        loopLength = SEQUENCER_MIN_LOOP_LENGTH;
+
+    sequence->events = events;
+    sequence->numEvents = numEvents;
+    sequence->loopLength = loopLength;
+    sequence->lookahead = SEQUENCER_DEFAULT_LOOKAHEAD;
+    sequence->priority = priority;
+    sequence->reverb = false;
+    sequence->isPlaying = false;
+    sequence->startTime = 0.0;
+    sequence->nextEvent = 0;
+    sequence->next = NULL;
+
+    for (uint32_t i = 0; i < SEQUENCER_MAX_CHANNELS; i++)
+    {
+        sequencer_Channel *channel = &sequence->channels[i];
+        channel->numVoices = 0;
+        channel->volume = 1.0f;
+        channel->pitch = 1.0f;
+        channel->pan = 0.0f;
+        channel->lastStartTime = 0.0;
+    }
+}
+
+void sequencer_play(sequencer_Sequence *sequence, double startTime)
+{
+    if (sequence->isPlaying)
+        sequencer_stop(sequence);
+
+    sequence->isPlaying = true;
+    sequence->startTime = startTime;
+    sequence->nextEvent = 0;
+    sequence->next = _activeSequences;
+    _activeSequences = sequence;
+
+    // schedule the first window right away, in case the sequence starts before the next sound_update
+    updateSequence(sequence, audio_getTime());
+}
+
+void sequencer_stop(sequencer_Sequence *sequence)
+{
+    if (!sequence->isPlaying)
+        return;
+
+    double now = audio_getTime();
+    for (uint32_t i = 0; i < SEQUENCER_MAX_CHANNELS; i++)
+    {
+        sequencer_Channel *channel = &sequence->channels[i];
+
+        // a note may already be queued to start inside the lookahead window, so it has to be stopped after it starts
+        stopChannel(channel, channel->lastStartTime > now ? channel->lastStartTime : now);
+    }
+
+    for (sequencer_Sequence **link = &_activeSequences; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == sequence)
+        {
+            *link = sequence->next;
+            break;
+        }
+    }
+
+    sequence->isPlaying = false;
+    sequence->next = NULL;
+}
+
+void sequencer_updateAll(double now)
+{
+    sequencer_Sequence **link = &_activeSequences;
+    while (*link != NULL)
+    {
+        sequencer_Sequence *sequence = *link;
+        if (updateSequence(sequence, now))
+        {
+            link = &sequence->next;
+        }
+        else
+        {
+            *link = sequence->next;
+            sequence->isPlaying = false;
+            sequence->next = NULL;
+        }
+    }
+}
@@ -0,0 +1,365 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_serial.h"
+#include "db_io.h"
+#include "db_log.h"
+
+// writer string table slots are 4 words: hash, offset of the bytes in the buffer, length, index + 1 (0 if empty)
+#define STRING_SLOT_WORDS 4
+
+// longest string worth looking up for reuse, longer strings are rarely repeated + expensive to hash
+#define MAX_SHARED_STRING_LEN 256
+
+static uint8_t reserve(serial_Writer *writer, uint32_t len)
+{
+    if (writer->error)
+        return false;
+
+    if (writer->len + len <= writer->cap)
+        return true;
+
+    uint32_t cap = writer->cap > 0 ? writer->cap : 64;
+    while (cap < writer->len + len)
+    {
+        cap *= 2;
+    }
+
+    uint8_t *data = realloc(writer->data, cap);
+    if (data == NULL)
+    {
+        db_log("Failed growing serial buffer");
+        writer->error = true;
+        return false;
+    }
+
+    writer->data = data;
+    writer->cap = cap;
+    return true;
+}
+
+void serial_initWriter(serial_Writer *writer, uint32_t capacity)
+{
+    memset(writer, 0, sizeof(serial_Writer));
+    reserve(writer, capacity);
+}
+
+void serial_freeWriter(serial_Writer *writer)
+{
+    free(writer->data);
+    free(writer->strings);
+    memset(writer, 0, sizeof(serial_Writer));
+}
+
+void serial_resetWriter(serial_Writer *writer)
+{
+    writer->len = 0;
+    writer->error = false;
+    writer->stringCount = 0;
+    if (writer->strings != NULL)
+        memset(writer->strings, 0, writer->stringsCap * STRING_SLOT_WORDS * sizeof(uint32_t));
+}
+
+void serial_writeVarint(serial_Writer *writer, uint64_t value)
+{
+    if (!reserve(writer, 10))
+        return;
+
+    uint8_t *out = writer->data + writer->len;
+    while (value >= 0x80)
+    {
+        *out++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    writer->len = (uint32_t)(out - writer->data);
+}
+
+void serial_writeSigned(serial_Writer *writer, int64_t value)
+{
+    serial_writeVarint(writer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void serial_writeFloat32(serial_Writer *writer, float value)
+{
+    serial_writeBytes(writer, &value, sizeof(float));
+}
+
+void serial_writeFloat64(serial_Writer *writer, double value)
+{
+    serial_writeBytes(writer, &value, sizeof(double));
+}
+
+void serial_writeBytes(serial_Writer *writer, const void *data, uint32_t len)
+{
+    if (!reserve(writer, len))
+        return;
+
+    memcpy(writer->data + writer->len, data, len);
+    writer->len += len;
+}
+
+static uint32_t hashString(const char *str, uint32_t len)
+{
+    uint32_t h = 0x811C9DC5;
+    for (uint32_t i = 0; i < len; i++)
+    {
+        h ^= (uint8_t)str[i];
+        h *= 0x01000193;
+    }
+
+    return h;
+}
+
+static uint8_t growStrings(serial_Writer *writer)
+{
+    uint32_t cap = writer->stringsCap > 0 ? writer->stringsCap * 2 : 64;
+    uint32_t *strings = calloc(cap, STRING_SLOT_WORDS * sizeof(uint32_t));
+    if (strings == NULL)
+        return false;
+
+    for (uint32_t i = 0; i < writer->stringsCap; i++)
+    {
+        const uint32_t *slot = writer->strings + i * STRING_SLOT_WORDS;
+        if (slot[3] == 0)
+            continue;
+
+        uint32_t j = slot[0] & (cap - 1);
+        while (strings[j * STRING_SLOT_WORDS + 3] != 0)
+        {
+            j = (j + 1) & (cap - 1);
+        }
+        memcpy(strings + j * STRING_SLOT_WORDS, slot, STRING_SLOT_WORDS * sizeof(uint32_t));
+    }
+
+    free(writer->strings);
+    writer->strings = strings;
+    writer->stringsCap = cap;
+    return true;
+}
+
+void serial_writeString(serial_Writer *writer, const char *str, uint32_t len)
+{
+    if (len > MAX_SHARED_STRING_LEN || (writer->stringCount * 2 >= writer->stringsCap && !growStrings(writer)))
+    {
+        // written inline + never referred back to, the reader still counts it as a distinct string
+        serial_writeVarint(writer, (uint64_t)len << 1);
+        serial_writeBytes(writer, str, len);
+        writer->stringCount++;
+        return;
+    }
+
+    uint32_t hash = hashString(str, len);
+    uint32_t mask = writer->stringsCap - 1;
+    uint32_t *slot;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        slot = writer->strings + i * STRING_SLOT_WORDS;
+        if (slot[3] == 0)
+            break;
+
+        if (slot[0] == hash && slot[2] == len && memcmp(writer->data + slot[1], str, len) == 0)
+        {
+            serial_writeVarint(writer, ((uint64_t)(slot[3] - 1) << 1) | 1);
+            return;
+        }
+    }
+
+    serial_writeVarint(writer, (uint64_t)len << 1);
+    uint32_t offset = writer->len;
+    serial_writeBytes(writer, str, len);
+    if (writer->error)
+        return;
+
+    slot[0] = hash;
+    slot[1] = offset;
+    slot[2] = len;
+    slot[3] = ++writer->stringCount;
+}
+
+uint8_t serial_saveFile(const serial_Writer *writer, const char *path)
+{
+    if (writer->error)
+        return false;
+
+    IOFILE *file = fs_open(path, IO_FILEMODE_WRITE);
+    if (file == NULL)
+    {
+        db_log("Failed opening file to save serialized data");
+        return false;
+    }
+
+    uint32_t written = fs_write(file, writer->data, writer->len);
+    fs_close(file);
+    return written == writer->len;
+}
+
+void serial_initReader(serial_Reader *reader, const uint8_t *data, uint32_t len)
+{
+    memset(reader, 0, sizeof(serial_Reader));
+    reader->data = data;
+    reader->len = len;
+}
+
+uint8_t serial_loadFile(serial_Reader *reader, const char *path)
+{
+    serial_initReader(reader, NULL, 0);
+
+    IOFILE *file = fs_open(path, IO_FILEMODE_READ);
+    if (file == NULL)
+    {
+        db_log("Failed opening serialized data file");
+        return false;
+    }
+
+    fs_seek(file, 0, IO_WHENCE_END);
+    uint32_t len = fs_tell(file);
+    fs_seek(file, 0, IO_WHENCE_BEGIN);
+
+    uint8_t *data = malloc(len > 0 ? len : 1);
+    if (data == NULL || fs_read(file, data, len) < len)
+    {
+        db_log("Failed reading serialized data file");
+        free(data);
+        fs_close(file);
+        return false;
+    }
+    fs_close(file);
+
+    reader->data = data;
+    reader->len = len;
+    reader->ownsData = true;
+    return true;
+}
+
+void serial_freeReader(serial_Reader *reader)
+{
+    if (reader->ownsData)
+        free((void *)reader->data);
+
+    free(reader->strings);
+    memset(reader, 0, sizeof(serial_Reader));
+}
+
+uint64_t serial_readVarint(serial_Reader *reader)
+{
+    if (reader->error)
+        return 0;
+
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7)
+    {
+        if (reader->pos >= reader->len)
+            break;
+
+        uint8_t b = reader->data[reader->pos++];
+        value |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return value;
+    }
+
+    reader->error = true;
+    return 0;
+}
+
+int64_t serial_readSigned(serial_Reader *reader)
+{
+    uint64_t v = serial_readVarint(reader);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+float serial_readFloat32(serial_Reader *reader)
+{
+    float value = 0.0f;
+    const uint8_t *bytes = serial_readBytes(reader, sizeof(float));
+    if (bytes != NULL)
+        memcpy(&value, bytes, sizeof(float));
+
+    return value;
+}
+
+double serial_readFloat64(serial_Reader *reader)
+{
+    double value = 0.0;
+    const uint8_t *bytes = serial_readBytes(reader, sizeof(double));
+    if (bytes != NULL)
+        memcpy(&value, bytes, sizeof(double));
+
+    return value;
+}
+
+uint32_t serial_readCount(serial_Reader *reader, uint32_t minElementSize)
+{
+    uint64_t count = serial_readVarint(reader);
+    uint64_t remaining = reader->len - reader->pos;
+    if (count > 0xFFFFFFFF || (minElementSize > 0 && count > remaining / minElementSize))
+    {
+        reader->error = true;
+        return 0;
+    }
+
+    return (uint32_t)count;
+}
+
+const uint8_t *serial_readBytes(serial_Reader *reader, uint32_t len)
+{
+    if (reader->error || len > reader->len - reader->pos)
+    {
+        reader->error = true;
+        return NULL;
+    }
+
+    const uint8_t *bytes = reader->data + reader->pos;
+    reader->pos += len;
+    return bytes;
+}
+
+const char *serial_readString(serial_Reader *reader, uint32_t *outLen)
+{
+    *outLen = 0;
+    uint64_t tag = serial_readVarint(reader);
+    if (reader->error)
+        return NULL;
+
+    if (tag & 1)
+    {
+        uint64_t index = tag >> 1;
+        if (index >= reader->stringCount)
+        {
+            reader->error = true;
+            return NULL;
+        }
+
+        *outLen = reader->strings[index * 2 + 1];
+        return (const char *)reader->data + reader->strings[index * 2];
+    }
+
+    uint64_t len = tag >> 1;
+    const uint8_t *bytes = len <= reader->len - reader->pos ? serial_readBytes(reader, (uint32_t)len) : NULL;
+    if (bytes == NULL)
+    {
+        reader->error = true;
+        return NULL;
+    }
+
+    if (reader->stringCount == reader->stringsCap)
+    {
+        uint32_t cap = reader->stringsCap > 0 ? reader->stringsCap * 2 : 64;
+        uint32_t *strings = realloc(reader->strings, cap * 2 * sizeof(uint32_t));
+        if (strings == NULL)
+        {
+            reader->error = true;
+            return NULL;
+        }
+        reader->strings = strings;
+        reader->stringsCap = cap;
+    }
+
+    reader->strings[reader->stringCount * 2] = (uint32_t)(bytes - reader->data);
+    reader->strings[reader->stringCount * 2 + 1] = (uint32_t)len;
+    reader->stringCount++;
+
+    *outLen = (uint32_t)len;
+    return (const char *)bytes;
+}
@@ -3,20 +3,42 @@
 #include <errno.h>
 #include <string.h>
 #include <math.h>
-#include <assert.h>
+#include <stddef.h>
 
 #include "db_sounddriver.h"
+#include "db_sequencer.h"
+#include "db_stream.h"
 #include "db_audio.h"
 #include "db_io.h"
 #include "db_log.h"
 
+#define VOICE_PARAM_COUNT 12
+
+// WAV headers are read in one block of this size, which covers the headers of most files
+#define WAV_HEADER_READ_SIZE 512
+
+// emitters which already own a hardware voice rank as if they were this much louder
+// keeps emitters of similar loudness from trading voices back and forth every update
+#define VIRTUALIZE_HYSTERESIS 1.5f
+
+typedef union
+{
+    int32_t i;
+    float f;
+} voiceParam;
+
 typedef struct sound_voice
 {
     uint32_t slot;
     uint8_t priority;
-    uint8_t isPlaying;
     uint32_t id;
     double playTime;
+
+    // value of the latest-timed write queued for each AUDIO_VOICEPARAM_*, and the time it takes effect
+    // bit N of paramCacheMask is set once param N has been queued
+    voiceParam paramCache[VOICE_PARAM_COUNT];
+    double paramCacheTime[VOICE_PARAM_COUNT];
+    uint16_t paramCacheMask;
 } sound_voice;
 
 typedef struct
@@ -47,27 +69,126 @@ typedef struct
 } wavChunkHeader;
 
 sound_voice _voices[32];
+
+// bit N is set if voice N is known to be free
+uint32_t _voiceFreeMask;
+
+// bit N is set if voice N is playing a looping sample, which never finishes on its own so it never needs polling
+uint32_t _voiceLoopMask;
+
+// bit N is set if voice N belongs to an emitter selected to keep its voice this update, protecting it from being stolen
+uint32_t _voiceReservedMask;
+
+// bit N is set if the state of voice N is known for this update (free, stopped, or already polled/started)
+// cleared for busy voices at the start of each sound_update so each one is polled from the hardware at most once per update
+uint32_t _voiceKnownMask;
+
+// audio time as of the last sound_update
+double _audioTime;
+
 sound_emitter *_ll_emitter_head;
 sound_emitter *_ll_voice_tail;
 
+// fixed pool of emitters - free emitters are linked through their `next` pointer
+sound_emitter _emitterPool[SOUND_MAX_EMITTERS];
+sound_emitter *_emitterFreeList;
+
 Vec3 _listenerPos;
 Quaternion _listenerRot;
-
-void queueStartVoice(uint32_t slot, double time)
+Quaternion _listenerInvRot;
+
+// per-update scratch space, filled by sound_update with one entry per playing emitter
+// 3D emitter positions are stored as separate arrays so the gain + pan math runs over contiguous floats
+sound_emitter *_updateEmitters[SOUND_MAX_EMITTERS];
+float _updateX[SOUND_MAX_EMITTERS];
+float _updateY[SOUND_MAX_EMITTERS];
+float _updateZ[SOUND_MAX_EMITTERS];
+float _updateDist[SOUND_MAX_EMITTERS];
+float _updateGain[SOUND_MAX_EMITTERS];
+
+// emitters competing for hardware voices, sorted so the first 32 are the highest ranked
+uint64_t _updateRank[SOUND_MAX_EMITTERS];
+uint16_t _updateOrder[SOUND_MAX_EMITTERS];
+float _updatePan[SOUND_MAX_EMITTERS];
+
+void queueStartVoice(uint32_t slot, uint8_t loop, double time)
 {
-    _voices[slot].isPlaying = true;
+    _voiceFreeMask &= ~(1u << slot);
+    _voiceKnownMask |= (1u << slot);
+    _voiceLoopMask = loop ? _voiceLoopMask | (1u << slot) : _voiceLoopMask & ~(1u << slot);
     audio_queueStartVoice(slot, time);
 }
 
 void queueStopVoice(uint32_t slot, double time)
 {
-    _voices[slot].isPlaying = false;
+    _voiceFreeMask |= (1u << slot);
+    _voiceKnownMask |= (1u << slot);
+    _voiceLoopMask &= ~(1u << slot);
     audio_queueStopVoice(slot, time);
 }
 
+// check whether a hardware voice is playing, polling the hardware only if its state isn't known yet this update
+uint8_t voiceIsPlaying(uint32_t slot)
+{
+    uint32_t bit = 1u << slot;
+    if (!(_voiceKnownMask & bit))
+    {
+        // voices scheduled to start in the future aren't playing yet, but they aren't free either
+        _voiceKnownMask |= bit;
+        if (!audio_getVoiceState(slot) && _voices[slot].playTime <= _audioTime)
+            _voiceFreeMask |= bit;
+    }
+
+    return !(_voiceFreeMask & bit);
+}
+
+static inline uint32_t rotateRight(uint32_t mask, uint32_t n)
+{
+    return n == 0 ? mask : (mask >> n) | (mask << (32 - n));
+}
+
+// writes aren't always queued in time order (a ramp queues all of its steps ahead), so the cache only describes the
+// voice from the time of its write onwards. earlier writes are always queued and don't replace the cached write
+static inline bool voiceParamCached(const sound_voice *voice, uint32_t param, double time)
+{
+    return (voice->paramCacheMask & (1 << param)) && time >= voice->paramCacheTime[param];
+}
+
+// queue a parameter change on the hardware voice, skipping it if the voice will already have that value by then
+static inline void voiceSetParam_i(sound_voice *voice, uint32_t param, int32_t value, double time)
+{
+    bool cached = voiceParamCached(voice, param, time);
+    if (cached && voice->paramCache[param].i == value)
+        return;
+
+    if (cached || !(voice->paramCacheMask & (1 << param)))
+    {
+        voice->paramCache[param].i = value;
+        voice->paramCacheTime[param] = time;
+        voice->paramCacheMask |= (1 << param);
+    }
+    audio_queueSetParam_i(voice->slot, param, value, time);
+}
+
+static inline void voiceSetParam_f(sound_voice *voice, uint32_t param, float value, double time)
+{
+    bool cached = voiceParamCached(voice, param, time);
+    if (cached && voice->paramCache[param].f == value)
+        return;
+
+    if (cached || !(voice->paramCacheMask & (1 << param)))
+    {
+        voice->paramCache[param].f = value;
+        voice->paramCacheTime[param] = time;
+        voice->paramCacheMask |= (1 << param);
+    }
+    audio_queueSetParam_f(voice->slot, param, value, time);
+}
+
 // allocate a voice for playback
 // attempts to find a voice that isn't already playing - otherwise, interrupt the oldest voice lower than or equal to the given priority
 // if a voice could not be allocated (all voices are playing and are higher priority), NULL is returned
+// voices in _voiceReservedMask are never returned. the caller claims the voice by setting its priority, id, and play time
 
 int voiceSearchStartIdx = 0;
 sound_voice *allocateVoice(uint8_t priority)
@@ -78,142 +199,428 @@ sound_voice *allocateVoice(uint8_t priority)
     // voice stealing scheme can sometimes steal voices too early because we have to schedule playback in advance
     // a simple round-robin search offset helps alleviate this
 
-    for (int i = 0; i < 32; i++)
+    uint32_t start = voiceSearchStartIdx & 31;
+    voiceSearchStartIdx++;
+
+    // no voice known to be free - poll busy voices we haven't checked yet this update until one turns out to have finished
+    uint32_t unknown = rotateRight(~_voiceKnownMask, start);
+    while ((_voiceFreeMask & ~_voiceReservedMask) == 0 && unknown != 0)
     {
-        int idx = (i + voiceSearchStartIdx) % 32;
-        sound_voice *vi = &_voices[idx];
+        voiceIsPlaying((__builtin_ctz(unknown) + start) & 31);
+        unknown &= unknown - 1;
+    }
 
-        if (!vi->isPlaying && !audio_getVoiceState(idx))
-        {
-            voice = vi;
-            break;
-        }
-        else if ((voice == NULL || vi->playTime < voice->playTime) && vi->priority >= priority)
+    uint32_t available = _voiceFreeMask & ~_voiceReservedMask;
+    if (available != 0)
+    {
+        // rotate the mask so the search begins at the round-robin offset, then take the lowest set bit
+        voice = &_voices[(__builtin_ctz(rotateRight(available, start)) + start) & 31];
+    }
+    else
+    {
+        // no free voices - steal the oldest voice with an equal or lower priority
+        for (uint32_t i = 0; i < 32; i++)
         {
-            voice = vi;
+            sound_voice *vi = &_voices[(i + start) & 31];
+            if (_voiceReservedMask & (1u << vi->slot))
+                continue;
+
+            if ((voice == NULL || vi->playTime < voice->playTime) && vi->priority >= priority)
+            {
+                voice = vi;
+            }
         }
     }
 
-    voiceSearchStartIdx++;
+    return voice;
+}
 
-    if (voice != NULL)
+// gain multiplier for an emitter at the given distance from the listener
+static inline float attenuate(const sound_emitter *emitter, float dist)
+{
+    dist = clamp(dist, emitter->attenMinDist, emitter->attenMaxDist);
+    switch (emitter->attenType)
     {
-        voice->priority = priority;
+    case SOUND_ATTEN_INV_DISTANCE:
+        return emitter->attenMinDist / (emitter->attenMinDist + emitter->attenRolloff * (dist - emitter->attenMinDist));
+    case SOUND_ATTEN_LINEAR:
+        return (1.0f - emitter->attenRolloff * (dist - emitter->attenMinDist) / (emitter->attenMaxDist - emitter->attenMinDist));
+    case SOUND_ATTEN_EXP_DISTANCE:
+        return powf(dist / emitter->attenMinDist, -emitter->attenRolloff);
+    default:
+        return 1.0f;
     }
-    return voice;
 }
 
-// update hardware voice with virtual voice state
-void update_voice(sound_emitter *emitter)
+// calculate gain + panning of a single emitter relative to the listener
+// sound_update does the same for all emitters at once, this is used when starting individual sounds
+static void calcEmitterGainPan(const sound_emitter *emitter, float *gain, float *pan)
 {
-    if (emitter->voice != NULL && emitter->id == emitter->voice->id)
+    *gain = emitter->volume;
+    *pan = emitter->pan;
+
+    if (emitter->is3D)
     {
-        double t = audio_getTime();
-        sound_voice *voice = emitter->voice;
+        // transform source position into listener local space
+        Vec3 localPos = vec3_transformQuat(_listenerInvRot, vec3_sub(emitter->position, _listenerPos));
+        float dist = vec3_length(localPos);
 
-        float gain = emitter->volume;
-        float pan = emitter->pan;
+        *gain *= attenuate(emitter, dist);
 
-        // apply attenuation + panning relative to listener
-        if (emitter->is3D)
-        {
-            // calculate gain from distance
-            float dist = clamp(vec3_distance(emitter->position, _listenerPos), emitter->attenMinDist, emitter->attenMaxDist);
-            switch (emitter->attenType)
-            {
-            case SOUND_ATTEN_INV_DISTANCE:
-                gain *= emitter->attenMinDist / (emitter->attenMinDist + emitter->attenRolloff * (dist - emitter->attenMinDist));
-                break;
-            case SOUND_ATTEN_LINEAR:
-                gain *= (1.0f - emitter->attenRolloff * (dist - emitter->attenMinDist) / (emitter->attenMaxDist - emitter->attenMinDist));
-                break;
-            case SOUND_ATTEN_EXP_DISTANCE:
-                gain *= powf(dist / emitter->attenMinDist, -emitter->attenRolloff);
-                break;
-            }
+        // normalize vector and use .x as pan value
+        *pan = dist > 0.0f ? localPos.x / dist : 0.0f;
+    }
+}
 
-            // calculate panning
-            // transform source position into listener local space
-            Vec3 localPos = vec3_sub(emitter->position, _listenerPos);
-            Quaternion invRot = _listenerRot;
-            quat_invert(&invRot);
-            localPos = vec3_transformQuat(invRot, localPos);
+// stereo samples play each channel on its own voice, hard panned left + right
+// the emitter pan shifts both channels, so a fully panned stereo emitter plays both channels from one side
+static inline float stereoPan(float pan, float channelPan)
+{
+    return clamp(pan + channelPan, -1.0f, 1.0f);
+}
 
-            // normalize vector and use .x as pan value
-            vec3_normalize(&localPos);
-            pan = localPos.x;
-        }
+static void pushVoiceParams(sound_voice *voice, const sound_emitter *emitter, int32_t sampleHandle, float gain, float pan, double t)
+{
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_SAMPLEDATA, sampleHandle, t);
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_SAMPLERATE, emitter->sample.samplerate, t);
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPENABLE, emitter->loop, t);
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPSTART, 0, t);
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPEND, 0, t);
+    voiceSetParam_i(voice, AUDIO_VOICEPARAM_RVBENABLE, emitter->reverb, t);
+    voiceSetParam_f(voice, AUDIO_VOICEPARAM_VOLUME, gain, t);
+    voiceSetParam_f(voice, AUDIO_VOICEPARAM_PITCH, emitter->pitch, t);
+    voiceSetParam_f(voice, AUDIO_VOICEPARAM_DETUNE, 0.0f, t);
+    voiceSetParam_f(voice, AUDIO_VOICEPARAM_PAN, pan, t);
+    voiceSetParam_f(voice, AUDIO_VOICEPARAM_FADEOUTLEN, 0.0f, t);
+}
+
+// stop a hardware voice, unless something else has since taken it over
+static void releaseVoice(sound_voice *voice, uint32_t id)
+{
+    if (voice != NULL && voice->id == id)
+    {
+        voice->priority = 255;
+        queueStopVoice(voice->slot, 0.0);
+    }
+}
+
+// stop + detach every hardware voice the emitter still owns, leaving it virtual
+static void releaseEmitterVoices(sound_emitter *emitter)
+{
+    releaseVoice(emitter->voice, emitter->id);
+    releaseVoice(emitter->voiceRight, emitter->idRight);
+    emitter->voice = NULL;
+    emitter->voiceRight = NULL;
+}
+
+// mask of the hardware voices attached to an emitter
+static inline uint32_t emitterVoiceMask(const sound_emitter *emitter)
+{
+    uint32_t mask = 0;
+    if (emitter->voice != NULL)
+        mask |= (1u << emitter->voice->slot);
+    if (emitter->voiceRight != NULL)
+        mask |= (1u << emitter->voiceRight->slot);
+    return mask;
+}
 
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_SAMPLEDATA, emitter->sample.handle, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_SAMPLERATE, emitter->sample.samplerate, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_LOOPENABLE, emitter->loop, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_LOOPSTART, 0, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_LOOPEND, 0, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_RVBENABLE, emitter->reverb, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_VOLUME, gain, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_PITCH, emitter->pitch, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_DETUNE, 0.0f, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_PAN, pan, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_FADEOUTLEN, 0.0f, t);
+// update hardware voice with virtual voice state
+// only parameters which differ from the last value queued on the voice are sent
+void update_voice(sound_emitter *emitter, float gain, float pan, double t)
+{
+    if (emitter->voice != NULL && emitter->id == emitter->voice->id)
+    {
+        if (emitter->voiceRight != NULL)
+        {
+            pushVoiceParams(emitter->voice, emitter, emitter->sample.handle, gain, stereoPan(pan, -1.0f), t);
+            pushVoiceParams(emitter->voiceRight, emitter, emitter->sample.handleRight, gain, stereoPan(pan, 1.0f), t);
+        }
+        else
+        {
+            pushVoiceParams(emitter->voice, emitter, emitter->sample.handle, gain, pan, t);
+        }
     }
     else
     {
         // something else may have stolen the hardware voice
-        emitter->voice = NULL;
+        releaseEmitterVoices(emitter);
     }
 }
 
-// attempt to assign a hardware voice to the given virtual voice
-void assign_hw_voice(sound_emitter *emitter)
+// claim an allocated voice, invalidating whatever was using it before
+static inline void claimVoice(sound_voice *voice, uint8_t priority, double t)
+{
+    voice->priority = priority;
+    voice->playTime = t;
+    voice->id++;
+}
+
+// attempt to assign a hardware voice (two for stereo samples) to the given virtual voice
+// on success the caller is responsible for pushing the emitter state with update_voice and starting the voice
+bool assign_hw_voice(sound_emitter *emitter, double t)
 {
     sound_voice *voice = allocateVoice(emitter->priority);
 
-    if (voice != NULL)
+    if (voice == NULL)
+        return false;
+
+    sound_voice *voiceRight = NULL;
+    if (emitter->sample.stereo)
     {
-        double t = audio_getTime();
+        // keep the second allocation from handing back the first voice
+        uint32_t reserved = _voiceReservedMask;
+        _voiceReservedMask |= (1u << voice->slot);
+        voiceRight = allocateVoice(emitter->priority);
+        _voiceReservedMask = reserved;
+
+        if (voiceRight == NULL)
+            return false;
+
+        claimVoice(voiceRight, emitter->priority, t);
+        emitter->voiceRight = voiceRight;
+        emitter->idRight = voiceRight->id;
+    }
+
+    claimVoice(voice, emitter->priority, t);
+    emitter->voice = voice;
+    emitter->id = voice->id;
 
-        voice->playTime = t;
-        voice->id++;
+    // the hardware can only start samples from the beginning
+    emitter->playPosition = 0.0f;
 
-        emitter->voice = voice;
-        emitter->id = voice->id;
+    return true;
+}
+
+// start the hardware voices assigned by assign_hw_voice
+static void startEmitterVoices(sound_emitter *emitter, double t)
+{
+    queueStartVoice(emitter->voice->slot, emitter->loop, t);
+    if (emitter->voiceRight != NULL)
+        queueStartVoice(emitter->voiceRight->slot, emitter->loop, t);
+}
 
-        update_voice(emitter);
+// assign a hardware voice to a newly created emitter and start it playing
+void start_emitter(sound_emitter *emitter)
+{
+    double t = audio_getTime();
+    emitter->playUpdateTime = t;
+
+    if (assign_hw_voice(emitter, t))
+    {
+        float gain, pan;
+        calcEmitterGainPan(emitter, &gain, &pan);
+        update_voice(emitter, gain, pan, t);
 
-        queueStartVoice(voice->slot, t);
+        startEmitterVoices(emitter, t);
     }
 }
 
-void sound_playOneShot(uint8_t priority, sound_sample sample, uint8_t reverb, float volume, float pitch, float pan)
+// play a sample on a hardware voice with no emitter attached, starting at time t
+static sound_voice *playVoice(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan, double t)
 {
     sound_voice *voice = allocateVoice(priority);
     if (voice != NULL)
     {
-        double t = audio_getTime();
+        claimVoice(voice, priority, t);
+
+        voiceSetParam_i(voice, AUDIO_VOICEPARAM_SAMPLEDATA, sample.handle, t);
+        voiceSetParam_i(voice, AUDIO_VOICEPARAM_SAMPLERATE, sample.samplerate, t);
+        voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPENABLE, loop, t);
+        if (loop)
+        {
+            voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPSTART, 0, t);
+            voiceSetParam_i(voice, AUDIO_VOICEPARAM_LOOPEND, 0, t);
+        }
+        voiceSetParam_i(voice, AUDIO_VOICEPARAM_RVBENABLE, reverb, t);
+        voiceSetParam_f(voice, AUDIO_VOICEPARAM_VOLUME, volume, t);
+        voiceSetParam_f(voice, AUDIO_VOICEPARAM_PITCH, pitch, t);
+        voiceSetParam_f(voice, AUDIO_VOICEPARAM_DETUNE, 0.0f, t);
+        voiceSetParam_f(voice, AUDIO_VOICEPARAM_PAN, pan, t);
+        voiceSetParam_f(voice, AUDIO_VOICEPARAM_FADEOUTLEN, 0.0f, t);
+
+        queueStartVoice(voice->slot, loop, t);
+    }
+
+    return voice;
+}
+
+// voice handles pack the voice slot into the low 8 bits and the low 24 bits of its id into the rest
+static inline sound_voiceHandle makeVoiceHandle(sound_voice *voice)
+{
+    return (voice->id << 8) | voice->slot;
+}
+
+// get the voice a handle refers to, or NULL if the voice has been reused since
+static inline sound_voice *getHandleVoice(sound_voiceHandle handle)
+{
+    if (handle == SOUND_INVALID_VOICE)
+        return NULL;
+
+    sound_voice *voice = &_voices[handle & 31];
+    return (voice->id & 0xFFFFFF) == (handle >> 8) ? voice : NULL;
+}
+
+uint32_t sound_playOneShotAt(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan, double time, sound_voiceHandle *outVoices)
+{
+    sound_voice *voices[2] = {NULL, NULL};
+    uint32_t count;
+
+    if (sample.stereo)
+    {
+        sound_sample right = sample;
+        right.handle = sample.handleRight;
+
+        voices[0] = playVoice(priority, sample, reverb, loop, volume, pitch, stereoPan(pan, -1.0f), time);
+        voices[1] = playVoice(priority, right, reverb, loop, volume, pitch, stereoPan(pan, 1.0f), time);
+        count = 2;
+    }
+    else
+    {
+        voices[0] = playVoice(priority, sample, reverb, loop, volume, pitch, pan, time);
+        count = 1;
+    }
+
+    if (outVoices != NULL)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            outVoices[i] = voices[i] != NULL ? makeVoiceHandle(voices[i]) : SOUND_INVALID_VOICE;
+    }
+
+    return count;
+}
+
+void sound_stopVoiceAt(sound_voiceHandle handle, double time)
+{
+    sound_voice *voice = getHandleVoice(handle);
+    if (voice == NULL)
+        return;
+
+    // the voice keeps playing until the stop time, so it isn't marked free here
+    // it no longer loops though, so it gets polled (and freed) once the hardware reports it stopped
+    _voiceLoopMask &= ~(1u << voice->slot);
+    audio_queueStopVoice(voice->slot, time);
+}
+
+void sound_setVoiceParamAt(sound_voiceHandle handle, uint32_t param, float value, double time)
+{
+    // param indexes the voice's param cache
+    if (param >= VOICE_PARAM_COUNT)
+        return;
+
+    sound_voice *voice = getHandleVoice(handle);
+    if (voice == NULL)
+        return;
+
+    voiceSetParam_f(voice, param, value, time);
+}
+
+void sound_playOneShot(uint8_t priority, sound_sample sample, uint8_t reverb, float volume, float pitch, float pan)
+{
+    sound_playOneShotAt(priority, sample, reverb, false, volume, pitch, pan, audio_getTime(), NULL);
+}
+
+void sound_playOneShot3D(uint8_t priority, sound_sample sample, uint8_t reverb, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff)
+{
+    // gain + pan are computed once from the current listener state, the voice isn't tracked afterwards
+    // the emitter only lives on the stack to describe the sound to calcEmitterGainPan
+    sound_emitter emitter;
+    emitter.is3D = true;
+    emitter.volume = volume;
+    emitter.pan = 0.0f;
+    emitter.position = position;
+    emitter.attenType = attenModel;
+    emitter.attenMinDist = attenMinDistance;
+    emitter.attenMaxDist = attenMaxDistance;
+    emitter.attenRolloff = attenRolloff;
+
+    float gain, pan;
+    calcEmitterGainPan(&emitter, &gain, &pan);
+
+    // out of earshot - don't spend a voice on it
+    if (gain <= 0.0f)
+        return;
+
+    sound_playOneShot(priority, sample, reverb, gain, pitch, pan);
+}
+
+// handles pack the emitter's pool index into the low 16 bits and its generation into the high 16 bits
+static inline sound_handle makeHandle(sound_emitter *emitter)
+{
+    return ((uint32_t)emitter->generation << 16) | (uint32_t)(emitter - _emitterPool);
+}
+
+// take an emitter from the pool and link it into the active emitter list
+// returns NULL if the pool is exhausted
+sound_emitter *allocateEmitter()
+{
+    sound_emitter *emitter = _emitterFreeList;
+    if (emitter == NULL)
+    {
+        db_log("Sound emitter pool exhausted");
+        return NULL;
+    }
+
+    _emitterFreeList = emitter->next;
+
+    emitter->isValid = true;
+    emitter->playPosition = 0.0f;
+    emitter->id = 0;
+    emitter->voice = NULL;
+    emitter->voiceRight = NULL;
+    emitter->prev = NULL;
+    emitter->next = NULL;
+
+    if (_ll_emitter_head == NULL)
+    {
+        _ll_emitter_head = emitter;
+        _ll_voice_tail = _ll_emitter_head;
+    }
+    else
+    {
+        _ll_voice_tail->next = emitter;
+        emitter->prev = _ll_voice_tail;
+        _ll_voice_tail = emitter;
+    }
+
+    return emitter;
+}
+
+// stop the emitter's hardware voice and unlink it from the active emitter list
+void stopEmitter(sound_emitter *emitter)
+{
+    if (!emitter->isValid)
+        return;
+
+    releaseEmitterVoices(emitter);
 
-        voice->playTime = t;
-        voice->id++;
+    if (emitter->prev != NULL)
+        emitter->prev->next = emitter->next;
 
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_SAMPLEDATA, sample.handle, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_SAMPLERATE, sample.samplerate, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_LOOPENABLE, false, t);
-        audio_queueSetParam_i(voice->slot, AUDIO_VOICEPARAM_RVBENABLE, reverb, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_VOLUME, volume, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_PITCH, pitch, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_DETUNE, 0.0f, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_PAN, pan, t);
-        audio_queueSetParam_f(voice->slot, AUDIO_VOICEPARAM_FADEOUTLEN, 0.0f, t);
+    if (emitter->next != NULL)
+        emitter->next->prev = emitter->prev;
 
-        queueStartVoice(voice->slot, t);
+    if (emitter == _ll_emitter_head)
+    {
+        _ll_emitter_head = emitter->next;
+    }
+
+    if (emitter == _ll_voice_tail)
+    {
+        _ll_voice_tail = emitter->prev;
     }
+
+    emitter->prev = NULL;
+    emitter->next = NULL;
+    emitter->isValid = false;
 }
 
-sound_emitter *sound_play(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan)
+sound_handle sound_play(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan)
 {
-    sound_emitter *virtualVoice = (sound_emitter *)malloc(sizeof(sound_emitter));
-    virtualVoice->isValid = true;
+    sound_emitter *virtualVoice = allocateEmitter();
+    if (virtualVoice == NULL)
+        return SOUND_INVALID_EMITTER;
+
     virtualVoice->priority = priority;
-    virtualVoice->id = 0;
     virtualVoice->sample = sample;
     virtualVoice->reverb = reverb;
     virtualVoice->loop = loop;
@@ -221,33 +628,19 @@ sound_emitter *sound_play(uint8_t priority, sound_sample sample, uint8_t reverb,
     virtualVoice->pitch = pitch;
     virtualVoice->pan = pan;
     virtualVoice->is3D = false;
-    virtualVoice->voice = NULL;
-    virtualVoice->prev = NULL;
-    virtualVoice->next = NULL;
 
-    assign_hw_voice(virtualVoice);
-
-    if (_ll_emitter_head == NULL)
-    {
-        _ll_emitter_head = virtualVoice;
-        _ll_voice_tail = _ll_emitter_head;
-    }
-    else
-    {
-        _ll_voice_tail->next = virtualVoice;
-        virtualVoice->prev = _ll_voice_tail;
-        _ll_voice_tail = virtualVoice;
-    }
+    start_emitter(virtualVoice);
 
-    return virtualVoice;
+    return makeHandle(virtualVoice);
 }
 
-sound_emitter *sound_play3D(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff)
+sound_handle sound_play3D(uint8_t priority, sound_sample sample, uint8_t reverb, uint8_t loop, float volume, float pitch, Vec3 position, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff)
 {
-    sound_emitter *virtualVoice = (sound_emitter *)malloc(sizeof(sound_emitter));
-    virtualVoice->isValid = true;
+    sound_emitter *virtualVoice = allocateEmitter();
+    if (virtualVoice == NULL)
+        return SOUND_INVALID_EMITTER;
+
     virtualVoice->priority = priority;
-    virtualVoice->id = 0;
     virtualVoice->sample = sample;
     virtualVoice->reverb = reverb;
     virtualVoice->loop = loop;
@@ -259,63 +652,64 @@ sound_emitter *sound_play3D(uint8_t priority, sound_sample sample, uint8_t rever
     virtualVoice->attenMinDist = attenMinDistance;
     virtualVoice->attenMaxDist = attenMaxDistance;
     virtualVoice->attenRolloff = attenRolloff;
-    virtualVoice->voice = NULL;
-    virtualVoice->prev = NULL;
-    virtualVoice->next = NULL;
-
-    assign_hw_voice(virtualVoice);
 
-    if (_ll_emitter_head == NULL)
-    {
-        _ll_emitter_head = virtualVoice;
-        _ll_voice_tail = _ll_emitter_head;
-    }
-    else
-    {
-        _ll_voice_tail->next = virtualVoice;
-        virtualVoice->prev = _ll_voice_tail;
-        _ll_voice_tail = virtualVoice;
-    }
+    start_emitter(virtualVoice);
 
-    return virtualVoice;
+    return makeHandle(virtualVoice);
 }
 
-void sound_setPosition(sound_emitter *voice, Vec3 position)
+sound_emitter *sound_getEmitter(sound_handle handle)
 {
-    voice->position = position;
+    uint32_t index = handle & 0xFFFF;
+    if (index >= SOUND_MAX_EMITTERS)
+        return NULL;
+
+    sound_emitter *emitter = &_emitterPool[index];
+    if (emitter->generation != (handle >> 16))
+        return NULL;
+
+    return emitter;
 }
 
-void sound_destroy(sound_emitter *voice)
+void sound_setPosition(sound_handle handle, Vec3 position)
 {
-    sound_stop(voice);
-    free(voice);
+    sound_emitter *emitter = sound_getEmitter(handle);
+    if (emitter == NULL)
+        return;
+
+    emitter->position = position;
 }
 
-void sound_stop(sound_emitter *voice)
+// stop the emitter + return it to the pool
+static void releaseEmitter(sound_emitter *emitter)
 {
-    if (!voice->isValid)
-        return;
+    stopEmitter(emitter);
 
-    if (voice->voice != NULL && voice->id == voice->voice->id)
-    {
-        voice->voice->priority = 255;
-        queueStopVoice(voice->voice->slot, 0.0);
-    }
+    // bump the generation so any remaining handles to this emitter go stale
+    emitter->generation++;
+    if (emitter->generation == 0)
+        emitter->generation = 1;
 
-    voice->prev->next = voice->next;
-    voice->next->prev = voice->prev;
+    emitter->next = _emitterFreeList;
+    _emitterFreeList = emitter;
+}
 
-    if (voice == _ll_emitter_head)
-    {
-        _ll_emitter_head = voice->next;
-    }
+void sound_destroy(sound_handle handle)
+{
+    sound_emitter *emitter = sound_getEmitter(handle);
+    if (emitter == NULL)
+        return;
 
-    if (voice == _ll_voice_tail)
-    {
-        _ll_voice_tail = voice->prev;
-    }
+    releaseEmitter(emitter);
+}
+
+void sound_stop(sound_handle handle)
+{
+    sound_emitter *emitter = sound_getEmitter(handle);
+    if (emitter == NULL)
+        return;
 
-    voice->isValid = false;
+    stopEmitter(emitter);
 }
 
 void sound_init()
@@ -323,57 +717,680 @@ void sound_init()
     _ll_emitter_head = NULL;
     _ll_voice_tail = NULL;
 
+    // bump every generation so handles from before a re-init go stale
+    _emitterFreeList = NULL;
+    for (int i = SOUND_MAX_EMITTERS - 1; i >= 0; i--)
+    {
+        sound_emitter *emitter = &_emitterPool[i];
+        emitter->generation++;
+        if (emitter->generation == 0)
+            emitter->generation = 1;
+
+        emitter->isValid = false;
+        emitter->prev = NULL;
+        emitter->next = _emitterFreeList;
+        _emitterFreeList = emitter;
+    }
+
     for (int i = 0; i < 32; i++)
     {
         _voices[i].slot = i;
         _voices[i].priority = 255;
+        _voices[i].paramCacheMask = 0;
     }
 
+    _voiceFreeMask = 0xFFFFFFFF;
+    _voiceKnownMask = 0xFFFFFFFF;
+    _voiceLoopMask = 0;
+    _voiceReservedMask = 0;
+    _audioTime = 0.0;
+
     _listenerPos = (Vec3){0.0f, 0.0f, 0.0f};
     _listenerRot = QUATERNION_IDENTITY;
+    _listenerInvRot = QUATERNION_IDENTITY;
 }
 
 void sound_setListener(Vec3 pos, Quaternion rot)
 {
     _listenerPos = pos;
     _listenerRot = rot;
+
+    // every 3D emitter is transformed by the inverse listener rotation, so only invert it when it changes
+    _listenerInvRot = rot;
+    quat_invert(&_listenerInvRot);
 }
 
-void sound_update()
+// length of a sample in seconds, or 0 if unknown
+static inline float sampleDuration(sound_sample sample)
 {
-    // iterate virtual sound sources
-    sound_emitter *curEmitter = _ll_emitter_head;
-    while (curEmitter != NULL)
+    return sample.length > 0 && sample.samplerate > 0 ? (float)sample.length / (float)sample.samplerate : 0.0f;
+}
+
+// rank key for an emitter - lower keys win hardware voices
+// orders by priority first, then by gain (non-negative float bits sort the same as the floats they represent)
+static inline uint64_t emitterRank(const sound_emitter *emitter, float gain)
+{
+    if (emitter->voice != NULL)
+        gain *= VIRTUALIZE_HYSTERESIS;
+
+    union
     {
-        // virtual voice is still waiting for a hardware voice, try and assign one (if it's looping - otherwise just stop the voice from playing)
-        // otherwise update hardware voice
-        if (curEmitter->voice == NULL && curEmitter->loop)
-        {
-            assign_hw_voice(curEmitter);
-        }
-        else
-        {
-            update_voice(curEmitter);
-        }
+        float f;
+        uint32_t u;
+    } bits = {gain > 0.0f ? gain : 0.0f};
 
-        if (!curEmitter->loop)
-        {
-            if (curEmitter->voice == NULL || audio_getVoiceState(curEmitter->voice->slot) == 0)
-            {
-                // something stole the hardware voice or the voice has stopped playing - stop the virtual voice and remove it from linked list
-                sound_emitter *cur = curEmitter;
-                curEmitter = curEmitter->next;
-                sound_stop(cur);
-                continue;
-            }
-        }
+    return ((uint64_t)emitter->priority << 32) | (0xFFFFFFFF - bits.u);
+}
 
-        curEmitter = curEmitter->next;
+// add the emitter in scratch slot idx to the list competing for hardware voices if it's eligible, returning the new list length
+// virtualized one-shots can't be resumed part way through, so only loops and one-shots which haven't started yet can gain a voice
+// silent loops give up their voice, they restart once they become audible
+static uint32_t addCandidate(uint32_t idx, uint32_t numCandidates)
+{
+    sound_emitter *emitter = _updateEmitters[idx];
+    uint8_t candidate = emitter->loop ? _updateGain[idx] > 0.0f : (emitter->voice != NULL || emitter->id == 0);
+
+    if (!candidate)
+    {
+        releaseEmitterVoices(emitter);
+        return numCandidates;
     }
+
+    _updateOrder[numCandidates] = idx;
+    return numCandidates + 1;
 }
 
-sound_sample sound_loadWavBytes(const uint8_t *data)
+// insertion sort order[0..count) by rank (count is at most 32)
+static void sortByRank(uint16_t *order, uint32_t count)
 {
+    for (uint32_t i = 1; i < count; i++)
+    {
+        uint16_t idx = order[i];
+        uint64_t rank = _updateRank[idx];
+
+        uint32_t j = i;
+        while (j > 0 && _updateRank[order[j - 1]] > rank)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = idx;
+    }
+}
+
+// partially sort order[0..count) so the k lowest ranked entries come first (quickselect)
+static void selectHighestRanked(uint16_t *order, uint32_t count, uint32_t k)
+{
+    uint32_t lo = 0;
+    uint32_t hi = count - 1;
+
+    while (lo < hi)
+    {
+        uint64_t pivot = _updateRank[order[lo + (hi - lo) / 2]];
+        uint32_t i = lo;
+        uint32_t j = hi;
+
+        while (i <= j)
+        {
+            while (_updateRank[order[i]] < pivot)
+                i++;
+            while (_updateRank[order[j]] > pivot)
+                j--;
+
+            if (i <= j)
+            {
+                uint16_t tmp = order[i];
+                order[i] = order[j];
+                order[j] = tmp;
+                i++;
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+
+        if (k <= j)
+            hi = j;
+        else if (k >= i)
+            lo = i;
+        else
+            break;
+    }
+}
+
+void sound_update()
+{
+    double t = audio_getTime();
+    _audioTime = t;
+
+    // busy one-shot voices may have finished since the last update, forget their state so they get polled again (lazily, at most once)
+    _voiceKnownMask = _voiceFreeMask | _voiceLoopMask;
+
+    // iterate virtual sound sources, advancing playback and collecting the ones still playing
+    uint32_t count = 0;
+    uint32_t count3D = 0;
+    sound_emitter *curEmitter = _ll_emitter_head;
+    while (curEmitter != NULL)
+    {
+        if ((curEmitter->voice != NULL && curEmitter->id != curEmitter->voice->id) ||
+            (curEmitter->voiceRight != NULL && curEmitter->idRight != curEmitter->voiceRight->id))
+        {
+            // something else stole a hardware voice - half a stereo sample is no good, so give up both
+            releaseEmitterVoices(curEmitter);
+        }
+
+        curEmitter->playPosition += (float)(t - curEmitter->playUpdateTime) * curEmitter->pitch;
+        curEmitter->playUpdateTime = t;
+
+        float duration = sampleDuration(curEmitter->sample);
+        if (curEmitter->loop)
+        {
+            if (duration > 0.0f)
+                curEmitter->playPosition = fmodf(curEmitter->playPosition, duration);
+        }
+        else
+        {
+            // one-shots are finished once their hardware voice stops, or once a virtualized one-shot's tracked position reaches the end
+            // finished one-shots go back to the pool, their handles go stale
+            uint8_t finished = curEmitter->voice != NULL ? !voiceIsPlaying(curEmitter->voice->slot) : curEmitter->playPosition >= duration;
+            if (finished)
+            {
+                sound_emitter *cur = curEmitter;
+                curEmitter = curEmitter->next;
+                releaseEmitter(cur);
+                continue;
+            }
+        }
+
+        // 3D emitters are packed at the front of the scratch arrays, 2D emitters at the back
+        uint32_t idx = curEmitter->is3D ? count3D++ : SOUND_MAX_EMITTERS - 1 - (count - count3D);
+        _updateEmitters[idx] = curEmitter;
+        if (curEmitter->is3D)
+        {
+            _updateX[idx] = curEmitter->position.x - _listenerPos.x;
+            _updateY[idx] = curEmitter->position.y - _listenerPos.y;
+            _updateZ[idx] = curEmitter->position.z - _listenerPos.z;
+        }
+        count++;
+
+        curEmitter = curEmitter->next;
+    }
+
+    uint32_t begin2D = SOUND_MAX_EMITTERS - (count - count3D);
+
+    // transform 3D emitters into listener local space, computing distance and pan
+    // written without calls or branches over plain float arrays so the compiler can vectorize it
+    float qx = _listenerInvRot.x;
+    float qy = _listenerInvRot.y;
+    float qz = _listenerInvRot.z;
+    float qw = _listenerInvRot.w;
+    for (uint32_t i = 0; i < count3D; i++)
+    {
+        float vx = _updateX[i];
+        float vy = _updateY[i];
+        float vz = _updateZ[i];
+
+        // same as vec3_transformQuat
+        float x = 2 * (qy * vz - qz * vy);
+        float y = 2 * (qz * vx - qx * vz);
+        float z = 2 * (qx * vy - qy * vx);
+        float rX = vx + x * qw + (qy * z - qz * y);
+        float rY = vy + y * qw + (qz * x - qx * z);
+        float rZ = vz + z * qw + (qx * y - qy * x);
+
+        // rotation preserves length, normalized .x is the pan value
+        float dist = sqrtf(rX * rX + rY * rY + rZ * rZ);
+        _updateDist[i] = dist;
+        _updatePan[i] = dist > 0.0f ? rX / dist : 0.0f;
+    }
+
+    for (uint32_t i = 0; i < count3D; i++)
+    {
+        sound_emitter *emitter = _updateEmitters[i];
+        _updateGain[i] = emitter->volume * attenuate(emitter, _updateDist[i]);
+    }
+
+    for (uint32_t i = begin2D; i < SOUND_MAX_EMITTERS; i++)
+    {
+        sound_emitter *emitter = _updateEmitters[i];
+        _updateGain[i] = emitter->volume;
+        _updatePan[i] = emitter->pan;
+    }
+
+    // collect the emitters competing for hardware voices
+    uint32_t numCandidates = 0;
+    for (uint32_t i = 0; i < count3D; i++)
+        numCandidates = addCandidate(i, numCandidates);
+
+    for (uint32_t i = begin2D; i < SOUND_MAX_EMITTERS; i++)
+        numCandidates = addCandidate(i, numCandidates);
+
+    // stereo emitters need two hardware voices
+    uint32_t voicesNeeded = 0;
+    for (uint32_t i = 0; i < numCandidates; i++)
+        voicesNeeded += 1 + _updateEmitters[_updateOrder[i]]->sample.stereo;
+
+    // keep the highest ranked emitters on hardware voices and virtualize the rest
+    uint32_t numSelected = numCandidates;
+    if (voicesNeeded > 32)
+    {
+        for (uint32_t i = 0; i < numCandidates; i++)
+        {
+            uint32_t idx = _updateOrder[i];
+            _updateRank[idx] = emitterRank(_updateEmitters[idx], _updateGain[idx]);
+        }
+
+        uint32_t numTop = numCandidates < 32 ? numCandidates : 32;
+        if (numTop < numCandidates)
+            selectHighestRanked(_updateOrder, numCandidates, numTop);
+
+        // with stereo emitters in the mix not all of the top 32 may fit - sort them and take as many as fit, in rank order
+        sortByRank(_updateOrder, numTop);
+
+        uint32_t voices = 0;
+        numSelected = 0;
+        while (numSelected < numTop)
+        {
+            voices += 1 + _updateEmitters[_updateOrder[numSelected]]->sample.stereo;
+            if (voices > 32)
+                break;
+
+            numSelected++;
+        }
+
+        for (uint32_t i = numSelected; i < numCandidates; i++)
+        {
+            releaseEmitterVoices(_updateEmitters[_updateOrder[i]]);
+        }
+    }
+
+    _voiceReservedMask = 0;
+    for (uint32_t i = 0; i < numSelected; i++)
+    {
+        _voiceReservedMask |= emitterVoiceMask(_updateEmitters[_updateOrder[i]]);
+    }
+
+    // push state to the hardware voices, starting newly assigned voices once their parameters have been queued
+    for (uint32_t i = 0; i < numSelected; i++)
+    {
+        uint32_t idx = _updateOrder[i];
+        sound_emitter *emitter = _updateEmitters[idx];
+
+        uint8_t start = false;
+        if (emitter->voice == NULL)
+        {
+            start = assign_hw_voice(emitter, t);
+            if (!start)
+                continue;
+
+            _voiceReservedMask |= emitterVoiceMask(emitter);
+        }
+
+        update_voice(emitter, _updateGain[idx], _updatePan[idx], t);
+
+        if (start)
+            startEmitterVoices(emitter, t);
+    }
+
+    _voiceReservedMask = 0;
+
+    // schedule the next window of sequencer events
+    sequencer_updateAll(t);
+}
+
+// convert 8-bit PCM from unsigned 0 .. 255 to signed -128 .. 127 (dst may equal src)
+// subtracting 128 just flips the top bit, so this works on 8 samples at a time
+static void convertPcm8(uint8_t *dst, const uint8_t *src, uint32_t len)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t v;
+        memcpy(&v, src + i, sizeof(v));
+        v ^= 0x8080808080808080ULL;
+        memcpy(dst + i, &v, sizeof(v));
+    }
+
+    for (; i < len; i++)
+    {
+        dst[i] = src[i] ^ 0x80;
+    }
+}
+
+// number of sample frames in a block of mono IMA ADPCM data
+// each block begins with a 4 byte header holding the first sample, followed by two 4-bit samples per byte
+static uint32_t adpcmSampleCount(uint32_t dataLen, uint32_t blockAlign)
+{
+    if (blockAlign <= 4)
+        return 0;
+
+    uint32_t count = (dataLen / blockAlign) * ((blockAlign - 4) * 2 + 1);
+    uint32_t remainder = dataLen % blockAlign;
+    if (remainder > 4)
+        count += (remainder - 4) * 2 + 1;
+
+    return count;
+}
+
+// check a WAV file's format is one we can upload, logging why if it isn't
+static uint8_t wavFormatSupported(uint16_t formatType, uint16_t bitsPerSample, uint16_t channels)
+{
+    if (channels != 1 && channels != 2)
+    {
+        db_logf("Unsupported channel count: %u", channels);
+        return false;
+    }
+
+    if (!(formatType == 1 && (bitsPerSample == 8 || bitsPerSample == 16)) && formatType != 0x11)
+    {
+        db_logf("Unsupported input format. format_type: %u bits_per_sample: %u", formatType, bitsPerSample);
+        return false;
+    }
+
+    return true;
+}
+
+// mix interleaved stereo PCM down to mono in place, returning the new length in bytes (8-bit data must already be signed)
+// plain loops over fixed size integers so the compiler can vectorize them
+static uint32_t downmixStereo(const sound_wavInfo *info, uint8_t *data, uint32_t len)
+{
+    if (info->bitsPerSample == 8)
+    {
+        int8_t *pcm = (int8_t *)data;
+        uint32_t frames = len / 2;
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            pcm[i] = (int8_t)((pcm[i * 2] + pcm[i * 2 + 1]) >> 1);
+        }
+        return frames;
+    }
+    else
+    {
+        int16_t *pcm = (int16_t *)data;
+        uint32_t frames = len / 4;
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            pcm[i] = (int16_t)((pcm[i * 2] + pcm[i * 2 + 1]) >> 1);
+        }
+        return frames * 2;
+    }
+}
+
+// split interleaved stereo into one buffer per channel
+// the left channel is compacted in place at the start of data, the right channel is written to right (len / 2 bytes)
+static void splitStereo(const sound_wavInfo *info, uint8_t *data, uint8_t *right, uint32_t len)
+{
+    if (info->formatType == 0x11)
+    {
+        // IMA ADPCM stereo blocks hold a 4 byte header per channel, then alternate 4 bytes (8 samples) of each channel
+        // each half becomes a mono block of half the size
+        uint32_t blockAlign = info->blockAlign;
+        uint32_t half = blockAlign / 2;
+        uint32_t blocks = len / blockAlign;
+        for (uint32_t b = 0; b < blocks; b++)
+        {
+            const uint8_t *src = data + b * blockAlign;
+            uint8_t *dstLeft = data + b * half;
+            uint8_t *dstRight = right + b * half;
+
+            for (uint32_t offset = 0; offset + 8 <= blockAlign; offset += 8)
+            {
+                memcpy(dstRight + offset / 2, src + offset + 4, 4);
+                memmove(dstLeft + offset / 2, src + offset, 4);
+            }
+        }
+    }
+    else if (info->bitsPerSample == 8)
+    {
+        uint32_t frames = len / 2;
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            uint8_t l = data[i * 2];
+            uint8_t r = data[i * 2 + 1];
+            data[i] = l;
+            right[i] = r;
+        }
+    }
+    else
+    {
+        int16_t *pcm = (int16_t *)data;
+        int16_t *pcmRight = (int16_t *)right;
+        uint32_t frames = len / 4;
+        for (uint32_t i = 0; i < frames; i++)
+        {
+            int16_t l = pcm[i * 2];
+            int16_t r = pcm[i * 2 + 1];
+            pcm[i] = l;
+            pcmRight[i] = r;
+        }
+    }
+}
+
+// upload WAV sample data (8-bit data must already have been converted to signed)
+static sound_sample uploadWavData(const sound_wavInfo *info, const void *data, uint32_t len)
+{
+    if (info->formatType == 0x11)
+    {
+        // IMA ADPCM
+        return (sound_sample){
+            audio_allocCompressed(data, len, info->blockAlign),
+            info->samplerate,
+            adpcmSampleCount(len, info->blockAlign)};
+    }
+    else if (info->bitsPerSample == 8)
+    {
+        return (sound_sample){
+            audio_alloc(data, len, AUDIO_FMT_PCM_S8),
+            info->samplerate,
+            len};
+    }
+    else
+    {
+        return (sound_sample){
+            audio_alloc(data, len, AUDIO_FMT_PCM_S16),
+            info->samplerate,
+            len / 2};
+    }
+}
+
+// upload WAV sample data from a buffer which may be modified, converting stereo data according to stereoMode
+// 8-bit data must already have been converted to signed
+static sound_sample uploadWavBuffer(const sound_wavInfo *info, uint8_t *data, uint32_t len, uint8_t stereoMode)
+{
+    if (info->channels == 1)
+        return uploadWavData(info, data, len);
+
+    sound_wavInfo mono = *info;
+    mono.channels = 1;
+
+    // ADPCM would have to be decoded to mix it down, so stereo ADPCM is always split
+    if (stereoMode == SOUND_STEREO_DOWNMIX && info->formatType != 0x11)
+        return uploadWavData(&mono, data, downmixStereo(info, data, len));
+
+    if (info->formatType == 0x11)
+    {
+        mono.blockAlign = info->blockAlign / 2;
+        len -= len % info->blockAlign;
+    }
+    else
+    {
+        len -= len % ((info->bitsPerSample / 8) * 2);
+    }
+
+    uint8_t *right = malloc(len / 2);
+    if (right == NULL)
+    {
+        db_log("Failed allocating stereo split buffer");
+        return (sound_sample){-1, 0};
+    }
+
+    splitStereo(info, data, right, len);
+
+    sound_sample sample = uploadWavData(&mono, data, len / 2);
+    sound_sample sampleRight = uploadWavData(&mono, right, len / 2);
+    free(right);
+
+    if (sample.handle == -1 || sampleRight.handle == -1)
+    {
+        if (sample.handle != -1)
+            audio_free(sample.handle);
+        if (sampleRight.handle != -1)
+            audio_free(sampleRight.handle);
+        return (sound_sample){-1, 0};
+    }
+
+    sample.stereo = true;
+    sample.handleRight = sampleRight.handle;
+    return sample;
+}
+
+// samples are cached by a hash of their data chunk, so loading the same sound twice shares one upload
+typedef struct
+{
+    uint64_t hash;
+    uint32_t dataLen;
+    uint32_t refCount;
+    uint16_t formatType;
+    uint16_t bitsPerSample;
+    uint16_t channels;
+    uint8_t stereoMode;
+    uint32_t samplerate;
+    sound_sample sample;
+} sampleCacheEntry;
+
+static sampleCacheEntry _sampleCache[SOUND_MAX_CACHED_SAMPLES];
+
+// 8-bit PCM is hashed as if it had already been converted to signed, so the hash is the same before + after convertPcm8
+#define PCM8_HASH_MASK 0x8080808080808080ull
+
+static inline uint64_t hashMix(uint64_t h, uint64_t w)
+{
+    h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 29);
+}
+
+// hash a sample data chunk. four independent lanes of 8 bytes are mixed at once so the multiplies overlap
+// xorMask is applied to every byte of the data before hashing
+static uint64_t hashSampleData(const uint8_t *data, uint32_t len, uint64_t xorMask)
+{
+    uint64_t lanes[4] = {len, 0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull};
+    uint32_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        uint64_t w[4];
+        memcpy(w, data + i, 32);
+        lanes[0] = hashMix(lanes[0], w[0] ^ xorMask);
+        lanes[1] = hashMix(lanes[1], w[1] ^ xorMask);
+        lanes[2] = hashMix(lanes[2], w[2] ^ xorMask);
+        lanes[3] = hashMix(lanes[3], w[3] ^ xorMask);
+    }
+
+    uint64_t h = hashMix(hashMix(hashMix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = hashMix(h, w ^ xorMask);
+    }
+
+    uint64_t tail = 0;
+    for (uint32_t shift = 0; i < len; i++, shift += 8)
+        tail |= (uint64_t)(data[i] ^ (uint8_t)xorMask) << shift;
+
+    h = hashMix(h, tail);
+    return h ^ (h >> 32);
+}
+
+static inline bool cacheEntryMatches(const sampleCacheEntry *entry, const sound_wavInfo *info, uint8_t stereoMode, uint64_t hash)
+{
+    // stereo mode only matters for stereo files
+    if (info->channels == 1)
+        stereoMode = SOUND_STEREO_DOWNMIX;
+
+    return entry->refCount > 0 && entry->hash == hash && entry->dataLen == info->dataLen &&
+           entry->formatType == info->formatType && entry->bitsPerSample == info->bitsPerSample &&
+           entry->channels == info->channels && entry->samplerate == info->samplerate && entry->stereoMode == stereoMode;
+}
+
+// look for an already uploaded copy of a sample, adding a reference to it if found
+static bool findCachedSample(const sound_wavInfo *info, uint8_t stereoMode, uint64_t hash, sound_sample *outSample)
+{
+    for (int i = 0; i < SOUND_MAX_CACHED_SAMPLES; i++)
+    {
+        sampleCacheEntry *entry = &_sampleCache[i];
+        if (cacheEntryMatches(entry, info, stereoMode, hash))
+        {
+            entry->refCount++;
+            *outSample = entry->sample;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// record a newly uploaded sample. if the cache is full the sample still works, it just isn't shared
+static void cacheSample(const sound_wavInfo *info, uint8_t stereoMode, uint64_t hash, sound_sample sample)
+{
+    if (sample.handle == -1)
+        return;
+
+    for (int i = 0; i < SOUND_MAX_CACHED_SAMPLES; i++)
+    {
+        sampleCacheEntry *entry = &_sampleCache[i];
+        if (entry->refCount == 0)
+        {
+            entry->hash = hash;
+            entry->dataLen = info->dataLen;
+            entry->refCount = 1;
+            entry->formatType = info->formatType;
+            entry->bitsPerSample = info->bitsPerSample;
+            entry->channels = info->channels;
+            entry->stereoMode = info->channels == 1 ? SOUND_STEREO_DOWNMIX : stereoMode;
+            entry->samplerate = info->samplerate;
+            entry->sample = sample;
+            return;
+        }
+    }
+}
+
+static void freeSample(sound_sample sample)
+{
+    audio_free(sample.handle);
+    if (sample.stereo)
+        audio_free(sample.handleRight);
+}
+
+void sound_releaseSample(sound_sample sample)
+{
+    if (sample.handle == -1)
+        return;
+
+    for (int i = 0; i < SOUND_MAX_CACHED_SAMPLES; i++)
+    {
+        sampleCacheEntry *entry = &_sampleCache[i];
+        if (entry->refCount > 0 && entry->sample.handle == sample.handle)
+        {
+            if (--entry->refCount == 0)
+                freeSample(entry->sample);
+            return;
+        }
+    }
+
+    // uploaded while the cache was full
+    freeSample(sample);
+}
+
+sound_sample sound_loadWavBytesLen(const uint8_t *data, uint32_t dataLen, uint8_t stereoMode)
+{
+    if (dataLen < sizeof(wavHeader))
+    {
+        db_log("WAV file truncated");
+        return (sound_sample){-1, 0};
+    }
+
     const uint8_t *reader = data;
     wavHeader header = *(wavHeader *)reader;
     reader += sizeof(wavHeader);
@@ -385,7 +1402,15 @@ sound_sample sound_loadWavBytes(const uint8_t *data)
         return (sound_sample){-1, 0};
     }
 
-    const uint8_t *reader_end = data + header.overall_size + 8;
+    // the RIFF size is only trusted as far as the buffer goes
+    uint64_t riffLen = (uint64_t)header.overall_size + 8;
+    const uint8_t *reader_end = data + (riffLen < dataLen ? riffLen : dataLen);
+
+    if (reader_end - reader < (ptrdiff_t)sizeof(wavHeaderFmt))
+    {
+        db_log("WAV file truncated");
+        return (sound_sample){-1, 0};
+    }
 
     wavHeaderFmt headerFmt = *(wavHeaderFmt *)reader;
     reader += sizeof(wavHeaderFmt);
@@ -397,23 +1422,30 @@ sound_sample sound_loadWavBytes(const uint8_t *data)
         return (sound_sample){-1, 0};
     }
 
-    if (headerFmt.channels != 1)
-    {
-        db_log("Stereo wav files unsupported");
+    if (!wavFormatSupported(headerFmt.format_type, headerFmt.bits_per_sample, headerFmt.channels))
         return (sound_sample){-1, 0};
-    }
 
     // skip over header data
+    if (headerFmt.length_of_fmt + 8 > (uint32_t)(reader_end - data) - sizeof(wavHeader))
+    {
+        db_log("WAV file truncated");
+        return (sound_sample){-1, 0};
+    }
     reader = data + sizeof(wavHeader) + headerFmt.length_of_fmt + 8;
 
     uint8_t dataFound = false;
 
     // start looking for data chunk
+    // every chunk header + body is checked against the RIFF size so a malformed file can't send the reader out of bounds
     wavChunkHeader chunkHeader;
-    while (!dataFound && reader < reader_end)
+    while (reader_end - reader >= (ptrdiff_t)sizeof(wavChunkHeader))
     {
         chunkHeader = *(wavChunkHeader *)reader;
         reader += sizeof(wavChunkHeader);
+
+        if (chunkHeader.chunk_size > (uint32_t)(reader_end - reader))
+            break;
+
         if (strncmp(&chunkHeader.id[0], "data", 4) == 0)
         {
             dataFound = true;
@@ -426,153 +1458,359 @@ sound_sample sound_loadWavBytes(const uint8_t *data)
         }
     }
 
-    assert(dataFound && "No data chunk found in wav file");
-
-    if (headerFmt.format_type == 1 && headerFmt.bits_per_sample == 8)
+    if (!dataFound)
     {
-        uint8_t *pcm8 = malloc(chunkHeader.chunk_size);
-        memcpy(pcm8, reader, chunkHeader.chunk_size);
+        db_log("No data chunk found in wav file");
+        return (sound_sample){-1, 0};
+    }
 
-        // convert from unsigned 0 .. 255 to signed -128 .. 127
-        for (int i = 0; i < chunkHeader.chunk_size; i++)
-        {
-            pcm8[i] -= 128;
-        }
+    sound_wavInfo info = {
+        headerFmt.format_type,
+        headerFmt.bits_per_sample,
+        headerFmt.block_align,
+        headerFmt.channels,
+        headerFmt.sample_rate,
+        (uint32_t)(reader - data),
+        chunkHeader.chunk_size};
 
-        int32_t sampleHandle = audio_alloc(pcm8, chunkHeader.chunk_size, AUDIO_FMT_PCM_S8);
-        free(pcm8);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
-    }
-    else if (headerFmt.format_type == 1 && headerFmt.bits_per_sample == 16)
-    {
-        int16_t *pcm16 = malloc(chunkHeader.chunk_size);
-        memcpy(pcm16, reader, chunkHeader.chunk_size);
+    uint8_t isPcm8 = info.formatType == 1 && info.bitsPerSample == 8;
 
-        int32_t sampleHandle = audio_alloc(pcm16, chunkHeader.chunk_size, AUDIO_FMT_PCM_S16);
-        free(pcm16);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
-    }
-    else if (headerFmt.format_type == 0x11)
-    {
-        // IMA ADPCM
-        uint8_t *adpcm = malloc(chunkHeader.chunk_size);
-        memcpy(adpcm, reader, chunkHeader.chunk_size);
+    uint64_t hash = hashSampleData(reader, info.dataLen, isPcm8 ? PCM8_HASH_MASK : 0);
+    sound_sample sample;
+    if (findCachedSample(&info, stereoMode, hash, &sample))
+        return sample;
 
-        int32_t sampleHandle = audio_allocCompressed(adpcm, chunkHeader.chunk_size, headerFmt.block_align);
-        free(adpcm);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
+    // audio_alloc copies the sample data into audio memory, so data which doesn't need converting is passed straight through
+    if (info.channels == 1 && !isPcm8)
+    {
+        sample = uploadWavData(&info, reader, info.dataLen);
+        cacheSample(&info, stereoMode, hash, sample);
+        return sample;
     }
-    else
+
+    uint8_t *buffer = malloc(info.dataLen);
+    if (buffer == NULL)
     {
-        db_logf("Unsupported input format. format_type: %u bits_per_sample: %u", headerFmt.format_type, headerFmt.bits_per_sample);
-        return (sound_sample){
-            -1,
-            0};
+        db_log("Failed allocating WAV conversion buffer");
+        return (sound_sample){-1, 0};
     }
+
+    if (isPcm8)
+        convertPcm8(buffer, reader, info.dataLen);
+    else
+        memcpy(buffer, reader, info.dataLen);
+
+    sample = uploadWavBuffer(&info, buffer, info.dataLen, stereoMode);
+    free(buffer);
+    cacheSample(&info, stereoMode, hash, sample);
+    return sample;
 }
 
-sound_sample sound_loadWav(IOFILE *file)
+sound_sample sound_loadWavBytesStereo(const uint8_t *data, uint8_t stereoMode)
 {
-    wavHeader header;
-    fs_read(file, &header, sizeof(wavHeader));
+    return sound_loadWavBytesLen(data, UINT32_MAX, stereoMode);
+}
 
-    // check RIFF string
-    if (strncmp(header.riff, "RIFF", 4) || strncmp(header.wave, "WAVE", 4))
+sound_sample sound_loadWavBytes(const uint8_t *data)
+{
+    return sound_loadWavBytesLen(data, UINT32_MAX, SOUND_STEREO_DOWNMIX);
+}
+
+// read the headers of a WAV file, leaving the file positioned at the start of the sample data
+static uint8_t readWavInfo(IOFILE *file, sound_wavInfo *info)
+{
+    // the headers are parsed out of one buffered read instead of a host read per header + chunk
+    uint8_t headerBuffer[WAV_HEADER_READ_SIZE];
+    stream_Reader reader;
+    stream_initAt(&reader, file, 0, headerBuffer, sizeof(headerBuffer));
+
+    wavHeader header;
+    if (stream_read(&reader, &header, sizeof(wavHeader)) < sizeof(wavHeader) ||
+        strncmp(header.riff, "RIFF", 4) || strncmp(header.wave, "WAVE", 4))
     {
         db_log("Input is not valid WAV file");
-        return (sound_sample){-1, 0};
+        return false;
     }
 
-    wavHeaderFmt headerFmt;
-    fs_read(file, &headerFmt, sizeof(wavHeaderFmt));
-
     // check fmt string
-    if (strncmp(headerFmt.fmt_chunk_marker, "fmt ", 4))
+    wavHeaderFmt headerFmt;
+    if (stream_read(&reader, &headerFmt, sizeof(wavHeaderFmt)) < sizeof(wavHeaderFmt) ||
+        strncmp(headerFmt.fmt_chunk_marker, "fmt ", 4))
     {
         db_log("Expected fmt chunk");
-        return (sound_sample){-1, 0};
+        return false;
     }
 
-    if (headerFmt.channels != 1)
-    {
-        db_log("Stereo wav files unsupported");
-        return (sound_sample){-1, 0};
-    }
+    if (!wavFormatSupported(headerFmt.format_type, headerFmt.bits_per_sample, headerFmt.channels))
+        return false;
 
     // skip over header data
-    fs_seek(file, sizeof(wavHeader) + headerFmt.length_of_fmt + 8, IO_WHENCE_BEGIN);
-
-    uint8_t dataFound = false;
+    stream_seek(&reader, sizeof(wavHeader) + headerFmt.length_of_fmt + 8);
 
     // start looking for data chunk
     wavChunkHeader chunkHeader;
-    while (fs_read(file, &chunkHeader, sizeof(chunkHeader)) == sizeof(chunkHeader))
+    while (stream_read(&reader, &chunkHeader, sizeof(chunkHeader)) == sizeof(chunkHeader))
     {
         if (strncmp(&chunkHeader.id[0], "data", 4) == 0)
         {
-            dataFound = true;
-            break;
+            info->formatType = headerFmt.format_type;
+            info->bitsPerSample = headerFmt.bits_per_sample;
+            info->blockAlign = headerFmt.block_align;
+            info->channels = headerFmt.channels;
+            info->samplerate = headerFmt.sample_rate;
+            info->dataOffset = stream_tell(&reader);
+            info->dataLen = chunkHeader.chunk_size;
+
+            // leave the file positioned at the sample data
+            stream_syncFile(&reader);
+            return true;
         }
         else
         {
             // skip chunk
-            fs_seek(file, chunkHeader.chunk_size, IO_WHENCE_CURRENT);
+            stream_skip(&reader, chunkHeader.chunk_size);
         }
     }
 
-    assert(dataFound && "No data chunk found in wav file");
+    db_log("No data chunk found in wav file");
+    return false;
+}
+
+uint8_t sound_beginLoadWav(sound_wavLoader *loader, IOFILE *file, uint8_t stereoMode)
+{
+    loader->file = file;
+    loader->stereoMode = stereoMode;
+    loader->buffer = NULL;
+    loader->bytesRead = 0;
+    loader->sample = (sound_sample){-1, 0};
 
-    if (headerFmt.format_type == 1 && headerFmt.bits_per_sample == 8)
+    if (!readWavInfo(file, &loader->info))
+        return false;
+
+    loader->buffer = malloc(loader->info.dataLen);
+    if (loader->buffer == NULL)
     {
-        uint8_t *pcm8 = malloc(chunkHeader.chunk_size);
-        fs_read(file, pcm8, chunkHeader.chunk_size);
+        db_log("Failed allocating WAV load buffer");
+        return false;
+    }
 
-        // convert from unsigned 0 .. 255 to signed -128 .. 127
-        for (int i = 0; i < chunkHeader.chunk_size; i++)
-        {
-            pcm8[i] -= 128;
-        }
+    return true;
+}
 
-        int32_t sampleHandle = audio_alloc(pcm8, chunkHeader.chunk_size, AUDIO_FMT_PCM_S8);
-        free(pcm8);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
+uint8_t sound_continueLoadWav(sound_wavLoader *loader, uint32_t maxBytes)
+{
+    if (loader->buffer == NULL)
+        return SOUND_LOAD_ERROR;
+
+    uint32_t len = loader->info.dataLen - loader->bytesRead;
+    if (len > maxBytes)
+        len = maxBytes;
+
+    uint8_t *block = loader->buffer + loader->bytesRead;
+    uint32_t read = fs_read(loader->file, block, len);
+
+    // convert each block as it arrives so the final step is just the upload
+    if (loader->info.formatType == 1 && loader->info.bitsPerSample == 8)
+        convertPcm8(block, block, read);
+
+    loader->bytesRead += read;
+
+    if (read < len)
+    {
+        db_log("WAV file truncated");
+        free(loader->buffer);
+        loader->buffer = NULL;
+        return SOUND_LOAD_ERROR;
     }
-    else if (headerFmt.format_type == 1 && headerFmt.bits_per_sample == 16)
+
+    if (loader->bytesRead < loader->info.dataLen)
+        return SOUND_LOAD_PENDING;
+
+    // the buffer has already been converted, so no hash mask is needed for 8-bit data
+    uint64_t hash = hashSampleData(loader->buffer, loader->info.dataLen, 0);
+    if (!findCachedSample(&loader->info, loader->stereoMode, hash, &loader->sample))
     {
-        int16_t *pcm16 = malloc(chunkHeader.chunk_size);
-        fs_read(file, pcm16, chunkHeader.chunk_size);
+        loader->sample = uploadWavBuffer(&loader->info, loader->buffer, loader->info.dataLen, loader->stereoMode);
+        cacheSample(&loader->info, loader->stereoMode, hash, loader->sample);
+    }
+    free(loader->buffer);
+    loader->buffer = NULL;
 
-        int32_t sampleHandle = audio_alloc(pcm16, chunkHeader.chunk_size, AUDIO_FMT_PCM_S16);
-        free(pcm16);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
+    return loader->sample.handle == -1 ? SOUND_LOAD_ERROR : SOUND_LOAD_DONE;
+}
+
+float sound_loadWavProgress(const sound_wavLoader *loader)
+{
+    if (loader->info.dataLen == 0)
+        return 1.0f;
+
+    return (float)loader->bytesRead / (float)loader->info.dataLen;
+}
+
+sound_sample sound_loadWavStereo(IOFILE *file, uint8_t stereoMode)
+{
+    sound_wavLoader loader;
+    if (!sound_beginLoadWav(&loader, file, stereoMode))
+        return (sound_sample){-1, 0};
+
+    sound_continueLoadWav(&loader, 0xFFFFFFFF);
+    return loader.sample;
+}
+
+sound_sample sound_loadWav(IOFILE *file)
+{
+    return sound_loadWavStereo(file, SOUND_STEREO_DOWNMIX);
+}
+
+// read the next segment of a stream into the staging buffer and upload it, returning the uploaded sample
+// looping streams wrap back to the start of the data when they reach the end
+static sound_sample readStreamSegment(sound_stream *stream)
+{
+    uint32_t remaining = stream->info.dataLen - stream->dataPos;
+    if (remaining == 0 && stream->loop)
+    {
+        fs_seek(stream->file, stream->info.dataOffset, IO_WHENCE_BEGIN);
+        stream->dataPos = 0;
+        remaining = stream->info.dataLen;
     }
-    else if (headerFmt.format_type == 0x11)
+
+    uint32_t len = remaining < stream->segmentLen ? remaining : stream->segmentLen;
+    uint32_t read = len > 0 ? fs_read(stream->file, stream->staging, len) : 0;
+    stream->dataPos += read;
+
+    // the file is shorter than its header claims, end the data here so the stream stops (or loops) at the real end
+    if (read < len)
+        stream->info.dataLen = stream->dataPos;
+
+    if (read == 0)
+        return (sound_sample){-1, 0};
+
+    if (stream->info.formatType == 1 && stream->info.bitsPerSample == 8)
+        convertPcm8(stream->staging, stream->staging, read);
+
+    // segments play on a single voice, so stereo streams are mixed down
+    return uploadWavBuffer(&stream->info, stream->staging, read, SOUND_STEREO_DOWNMIX);
+}
+
+uint8_t sound_openStream(sound_stream *stream, IOFILE *file, uint32_t segmentLen, uint8_t priority, uint8_t loop, float volume, float pan)
+{
+    memset(stream, 0, sizeof(sound_stream));
+    stream->file = file;
+    stream->priority = priority;
+    stream->loop = loop;
+    stream->volume = volume;
+    stream->pan = pan;
+
+    for (int i = 0; i < SOUND_STREAM_SEGMENTS; i++)
+        stream->segments[i].sample.handle = -1;
+
+    if (!readWavInfo(file, &stream->info))
+        return false;
+
+    if (stream->info.formatType == 0x11 && stream->info.channels != 1)
     {
-        // IMA ADPCM
-        uint8_t *adpcm = malloc(chunkHeader.chunk_size);
-        fs_read(file, adpcm, chunkHeader.chunk_size);
+        db_log("Stereo ADPCM streams unsupported");
+        return false;
+    }
 
-        int32_t sampleHandle = audio_allocCompressed(adpcm, chunkHeader.chunk_size, headerFmt.block_align);
-        free(adpcm);
-        return (sound_sample){
-            sampleHandle,
-            headerFmt.sample_rate};
+    // segments must hold whole ADPCM blocks / sample frames
+    uint32_t unit = stream->info.formatType == 0x11 ? stream->info.blockAlign : (stream->info.bitsPerSample / 8) * stream->info.channels;
+    if (unit == 0)
+        unit = 1;
+
+    segmentLen -= segmentLen % unit;
+    if (segmentLen == 0)
+        segmentLen = unit;
+
+    stream->segmentLen = segmentLen;
+    stream->staging = malloc(segmentLen);
+    if (stream->staging == NULL)
+    {
+        db_log("Failed allocating stream staging buffer");
+        return false;
     }
-    else
+
+    stream->isPlaying = true;
+    sound_updateStream(stream);
+
+    return true;
+}
+
+void sound_updateStream(sound_stream *stream)
+{
+    if (!stream->isPlaying)
+        return;
+
+    double t = audio_getTime();
+    uint8_t queued = 0;
+
+    // release segments which have finished playing
+    for (int i = 0; i < SOUND_STREAM_SEGMENTS; i++)
     {
-        db_logf("Unsupported input format. format_type: %u bits_per_sample: %u", headerFmt.format_type, headerFmt.bits_per_sample);
-        return (sound_sample){
-            -1,
-            0};
+        sound_streamSegment *segment = &stream->segments[i];
+        if (segment->sample.handle == -1)
+            continue;
+
+        if (segment->endTime <= t)
+        {
+            audio_free(segment->sample.handle);
+            segment->sample.handle = -1;
+        }
+        else
+        {
+            queued++;
+        }
+    }
+
+    // fell behind (or just started) - schedule the next segment slightly ahead of now so it isn't cut off
+    if (queued == 0 || stream->nextStartTime < t)
+        stream->nextStartTime = t + SOUND_STREAM_LEAD_TIME;
+
+    // keep every segment slot filled, each new segment scheduled to start right as the previous one ends
+    for (int i = 0; i < SOUND_STREAM_SEGMENTS; i++)
+    {
+        sound_streamSegment *segment = &stream->segments[i];
+        if (segment->sample.handle != -1)
+            continue;
+
+        if (stream->dataPos >= stream->info.dataLen && !stream->loop)
+            break;
+
+        sound_sample sample = readStreamSegment(stream);
+        if (sample.handle == -1)
+            break;
+
+        segment->sample = sample;
+        segment->voice = playVoice(stream->priority, sample, false, false, stream->volume, 1.0f, stream->pan, stream->nextStartTime);
+        segment->voiceId = segment->voice != NULL ? segment->voice->id : 0;
+
+        stream->nextStartTime += (double)sample.length / (double)sample.samplerate;
+        segment->endTime = stream->nextStartTime;
+        queued++;
     }
-}
\ No newline at end of file
+
+    if (queued == 0)
+    {
+        // reached the end of a non-looping stream
+        stream->isPlaying = false;
+    }
+}
+
+void sound_closeStream(sound_stream *stream)
+{
+    for (int i = 0; i < SOUND_STREAM_SEGMENTS; i++)
+    {
+        sound_streamSegment *segment = &stream->segments[i];
+        if (segment->sample.handle == -1)
+            continue;
+
+        releaseVoice(segment->voice, segment->voiceId);
+
+        audio_free(segment->sample.handle);
+        segment->sample.handle = -1;
+    }
+
+    free(stream->staging);
+    stream->staging = NULL;
+    stream->isPlaying = false;
+}
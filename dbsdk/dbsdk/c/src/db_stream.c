@@ -0,0 +1,180 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db_stream.h"
+#include "db_log.h"
+
+// the underlying file is always positioned at the end of the buffered data, bufferOffset + bufferLen
+
+static inline uint32_t buffered(const stream_Reader *reader)
+{
+    return reader->bufferLen - reader->bufferPos;
+}
+
+// drop consumed bytes from the front of the buffer + top it up with one host read
+static void fill(stream_Reader *reader)
+{
+    uint32_t remaining = buffered(reader);
+    if (reader->bufferPos > 0)
+    {
+        memmove(reader->buffer, reader->buffer + reader->bufferPos, remaining);
+        reader->bufferOffset += reader->bufferPos;
+        reader->bufferPos = 0;
+        reader->bufferLen = remaining;
+    }
+
+    uint32_t len = reader->bufferSize - reader->bufferLen;
+    if (len == 0 || reader->eof)
+        return;
+
+    uint32_t read = fs_read(reader->file, reader->buffer + reader->bufferLen, len);
+    reader->bufferLen += read;
+
+    if (read < len)
+        reader->eof = true;
+}
+
+// throw away the buffered block, the file is then positioned at bufferOffset
+static inline void discard(stream_Reader *reader, uint32_t position)
+{
+    reader->bufferOffset = position;
+    reader->bufferPos = 0;
+    reader->bufferLen = 0;
+    reader->eof = false;
+}
+
+void stream_initAt(stream_Reader *reader, IOFILE *file, uint32_t position, uint8_t *buffer, uint32_t bufferSize)
+{
+    reader->file = file;
+    reader->buffer = buffer;
+    reader->bufferSize = bufferSize;
+    reader->ownsBuffer = false;
+    discard(reader, position);
+}
+
+uint8_t stream_open(stream_Reader *reader, IOFILE *file, uint32_t blockSize)
+{
+    if (blockSize == 0)
+        blockSize = STREAM_DEFAULT_BLOCK_SIZE;
+
+    uint8_t *buffer = malloc(blockSize);
+    if (buffer == NULL)
+    {
+        db_log("Failed allocating stream buffer");
+        return false;
+    }
+
+    stream_initAt(reader, file, fs_tell(file), buffer, blockSize);
+    reader->ownsBuffer = true;
+    return true;
+}
+
+void stream_close(stream_Reader *reader)
+{
+    if (reader->ownsBuffer)
+        free(reader->buffer);
+
+    reader->buffer = NULL;
+    reader->bufferSize = 0;
+    reader->ownsBuffer = false;
+}
+
+uint32_t stream_read(stream_Reader *reader, void *dst, uint32_t len)
+{
+    uint8_t *out = dst;
+    uint32_t copied = 0;
+
+    while (copied < len)
+    {
+        uint32_t avail = buffered(reader);
+        if (avail > 0)
+        {
+            uint32_t n = len - copied < avail ? len - copied : avail;
+            memcpy(out + copied, reader->buffer + reader->bufferPos, n);
+            reader->bufferPos += n;
+            copied += n;
+            continue;
+        }
+
+        if (reader->eof)
+            break;
+
+        uint32_t remaining = len - copied;
+        if (remaining >= reader->bufferSize)
+        {
+            // too big to be worth staging, read it straight into the destination
+            discard(reader, reader->bufferOffset + reader->bufferLen);
+            uint32_t read = fs_read(reader->file, out + copied, remaining);
+            reader->bufferOffset += read;
+            reader->eof = read < remaining;
+            copied += read;
+            break;
+        }
+
+        fill(reader);
+    }
+
+    return copied;
+}
+
+const uint8_t *stream_peek(stream_Reader *reader, uint32_t len)
+{
+    if (len > reader->bufferSize)
+        return NULL;
+
+    if (buffered(reader) < len)
+        fill(reader);
+
+    if (buffered(reader) < len)
+        return NULL;
+
+    return reader->buffer + reader->bufferPos;
+}
+
+void stream_skip(stream_Reader *reader, uint32_t len)
+{
+    if (len <= buffered(reader))
+        reader->bufferPos += len;
+    else
+        stream_seek(reader, stream_tell(reader) + len);
+}
+
+uint32_t stream_tell(const stream_Reader *reader)
+{
+    return reader->bufferOffset + reader->bufferPos;
+}
+
+void stream_seek(stream_Reader *reader, uint32_t position)
+{
+    if (position >= reader->bufferOffset && position <= reader->bufferOffset + reader->bufferLen)
+    {
+        reader->bufferPos = position - reader->bufferOffset;
+        return;
+    }
+
+    fs_seek(reader->file, position, IO_WHENCE_BEGIN);
+    discard(reader, position);
+}
+
+uint8_t stream_eof(stream_Reader *reader)
+{
+    if (buffered(reader) > 0)
+        return false;
+
+    fill(reader);
+    return buffered(reader) == 0;
+}
+
+void stream_syncFile(stream_Reader *reader)
+{
+    if (reader->bufferPos == reader->bufferLen)
+    {
+        discard(reader, reader->bufferOffset + reader->bufferLen);
+        return;
+    }
+
+    uint32_t position = stream_tell(reader);
+    fs_seek(reader->file, position, IO_WHENCE_BEGIN);
+    discard(reader, position);
+}
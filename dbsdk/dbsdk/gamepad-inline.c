@@ -49,4 +49,4 @@ int16_t kk_dbsdk_gamepad__State_rStickY(kk_box_t gpad_boxed_ptr, kk_context_t *c
   int16_t rStickY = gpad->rStickY;
   kk_box_drop(gpad_boxed_ptr, ctx);
   return rStickY;
-}
\ No newline at end of file
+}
@@ -11,4 +11,26 @@ uint16_t kk_dbsdk_gamepad__State_btnMask(kk_box_t, kk_context_t*);
 int16_t kk_dbsdk_gamepad__State_lStickX(kk_box_t, kk_context_t*);
 int16_t kk_dbsdk_gamepad__State_lStickY(kk_box_t, kk_context_t*);
 int16_t kk_dbsdk_gamepad__State_rStickX(kk_box_t, kk_context_t*);
-int16_t kk_dbsdk_gamepad__State_rStickY(kk_box_t, kk_context_t*);
\ No newline at end of file
+int16_t kk_dbsdk_gamepad__State_rStickY(kk_box_t, kk_context_t*);
+
+// The snapshot + connection cache are the ones db_input uses, so mixing read-pads and dbsdk/input reads the pads once.
+static inline kk_unit_t dbsdk_gamepad__readPads() {
+  input_readPads();
+  return kk_Unit;
+}
+
+// Bit 16 is set if the pad is connected.
+static inline int32_t dbsdk_gamepad__Pad_buttons(uint32_t port) {
+  const gamepad_State *gpad = input_padState(port);
+  return gpad != NULL ? (int32_t)(((uint32_t)input_isConnected(port) << 16) | gpad->btnMask) : 0;
+}
+
+static inline int64_t dbsdk_gamepad__Pad_sticks(uint32_t port) {
+  const gamepad_State *gpad = input_padState(port);
+  if (gpad == NULL) return 0;
+
+  return (int64_t)((uint64_t)(uint16_t)gpad->lStickX |
+    ((uint64_t)(uint16_t)gpad->lStickY << 16) |
+    ((uint64_t)(uint16_t)gpad->rStickX << 32) |
+    ((uint64_t)(uint16_t)gpad->rStickY << 48));
+}
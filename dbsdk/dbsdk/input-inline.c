@@ -0,0 +1,18 @@
+int32_t kk_dbsdk_input__heldAgo(uint32_t port, uint32_t framesAgo, kk_context_t *ctx) {
+  kk_unused(ctx);
+  const gamepad_State *state = input_state(port, framesAgo);
+  return state != NULL ? state->btnMask : 0;
+}
+
+int16_t kk_dbsdk_input__stick(uint32_t port, uint32_t framesAgo, uint32_t axis, kk_context_t *ctx) {
+  kk_unused(ctx);
+  const gamepad_State *state = input_state(port, framesAgo);
+  if (state == NULL) return 0;
+
+  switch (axis) {
+    case 0: return state->lStickX;
+    case 1: return state->lStickY;
+    case 2: return state->rStickX;
+    default: return state->rStickY;
+  }
+}
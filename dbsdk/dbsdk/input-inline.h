@@ -0,0 +1,29 @@
+static inline kk_unit_t dbsdk_input__update() {
+  input_update();
+  return kk_Unit;
+}
+
+static inline kk_unit_t dbsdk_input__setDeadzone(uint32_t port, int32_t deadzone) {
+  input_setDeadzone(port, (int16_t)(deadzone < 0 ? 0 : (deadzone > 32766 ? 32766 : deadzone)));
+  return kk_Unit;
+}
+
+// Button masks are returned as int32 so buttons above bit 15 don't turn negative.
+static inline int32_t dbsdk_input__held(uint32_t port) {
+  return input_held(port);
+}
+
+static inline int32_t dbsdk_input__pressed(uint32_t port) {
+  return input_pressed(port);
+}
+
+static inline int32_t dbsdk_input__released(uint32_t port) {
+  return input_released(port);
+}
+
+static inline int32_t dbsdk_input__pressedWithin(uint32_t port, int32_t mask, uint32_t framesAgo, uint32_t frames) {
+  return input_pressedWithin(port, (uint16_t)mask, framesAgo, frames);
+}
+
+int32_t kk_dbsdk_input__heldAgo(uint32_t, uint32_t, kk_context_t*);
+int16_t kk_dbsdk_input__stick(uint32_t, uint32_t, uint32_t, kk_context_t*);
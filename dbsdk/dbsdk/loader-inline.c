@@ -0,0 +1,90 @@
+// Koka callbacks are kept per request slot and called from loader_update. The
+// update is always started from Koka, so its context is saved for the calls.
+static kk_context_t *LOADER_CTX;
+static kk_function_t LOADER_CALLBACKS[LOADER_MAX_REQUESTS];
+
+static void kk_dbsdk_loader__free_Loaded(void *result_ptr, kk_block_t *b, kk_context_t *ctx) {
+  kk_unused(ctx);
+  loader_Result *result = (loader_Result*)result_ptr;
+  if (result != NULL) {
+    free(result->data);
+    free(result);
+  }
+}
+
+// The result is boxed as-is for Koka, which frees the file contents once it is
+// no longer referenced. Failed loads are passed on with a NULL data pointer.
+static void kk_dbsdk_loader__on_done(loader_handle handle, loader_Result *result, void *userData) {
+  kk_context_t *ctx = LOADER_CTX;
+  kk_function_t callback = LOADER_CALLBACKS[handle & 0xFF];
+
+  loader_Result *loaded = malloc(sizeof(loader_Result));
+  *loaded = *result;
+  kk_box_t loaded_boxed_ptr = kk_cptr_raw_box(&kk_dbsdk_loader__free_Loaded, loaded, ctx);
+
+  kk_box_t unit = kk_function_call(
+    kk_box_t, // ret type.
+    (kk_function_t, kk_box_t, kk_context_t*), // fn arg types.
+    callback, // fn to call.
+    (callback, loaded_boxed_ptr, ctx), // fn args.
+    ctx
+  );
+  kk_box_drop(unit, ctx);
+}
+
+int32_t kk_dbsdk_loader__loader_load(kk_string_t path, uint8_t priority, kk_function_t callback, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  loader_handle handle = loader_load((const char*)cstr, priority, kk_dbsdk_loader__on_done, NULL);
+  kk_string_drop(path, ctx);
+
+  if (handle == LOADER_INVALID_HANDLE) {
+    kk_function_drop(callback, ctx);
+  } else {
+    LOADER_CALLBACKS[handle & 0xFF] = callback;
+  }
+  return (int32_t)handle;
+}
+
+kk_unit_t kk_dbsdk_loader__loader_cancel(int32_t handle, kk_context_t *ctx) {
+  if (loader_getState((loader_handle)handle) != LOADER_STATE_INVALID) {
+    loader_cancel((loader_handle)handle);
+    kk_function_drop(LOADER_CALLBACKS[handle & 0xFF], ctx);
+  }
+  return kk_Unit;
+}
+
+kk_unit_t kk_dbsdk_loader__loader_update(kk_context_t *ctx) {
+  LOADER_CTX = ctx;
+  loader_update();
+  return kk_Unit;
+}
+
+uint8_t kk_dbsdk_loader__Loaded_isValid(kk_box_t loaded_boxed_ptr, kk_context_t *ctx) {
+  loader_Result *loaded = (loader_Result*)kk_cptr_raw_unbox_borrowed(loaded_boxed_ptr, ctx);
+  uint8_t isValid = loaded->state == LOADER_STATE_DONE;
+  kk_box_drop(loaded_boxed_ptr, ctx);
+  return isValid;
+}
+
+intptr_t kk_dbsdk_loader__Loaded_data(kk_box_t loaded_boxed_ptr, kk_context_t *ctx) {
+  loader_Result *loaded = (loader_Result*)kk_cptr_raw_unbox_borrowed(loaded_boxed_ptr, ctx);
+  intptr_t data = (intptr_t)loaded->data;
+  kk_box_drop(loaded_boxed_ptr, ctx);
+  return data;
+}
+
+uint32_t kk_dbsdk_loader__Loaded_size(kk_box_t loaded_boxed_ptr, kk_context_t *ctx) {
+  loader_Result *loaded = (loader_Result*)kk_cptr_raw_unbox_borrowed(loaded_boxed_ptr, ctx);
+  uint32_t size = loaded->data != NULL ? loaded->size : 0;
+  kk_box_drop(loaded_boxed_ptr, ctx);
+  return size;
+}
+
+// Invalid UTF-8 in the data is replaced, so this is only meant for text.
+kk_string_t kk_dbsdk_loader__Loaded_text(kk_box_t loaded_boxed_ptr, kk_context_t *ctx) {
+  loader_Result *loaded = (loader_Result*)kk_cptr_raw_unbox_borrowed(loaded_boxed_ptr, ctx);
+  kk_string_t str = kk_string_alloc_from_qutf8n(loaded->data != NULL ? loaded->size : 0, (const char*)loaded->data, ctx);
+  kk_box_drop(loaded_boxed_ptr, ctx);
+  return str;
+}
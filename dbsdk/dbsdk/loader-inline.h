@@ -0,0 +1,13 @@
+int32_t kk_dbsdk_loader__loader_load(kk_string_t, uint8_t, kk_function_t, kk_context_t*);
+kk_unit_t kk_dbsdk_loader__loader_cancel(int32_t, kk_context_t*);
+kk_unit_t kk_dbsdk_loader__loader_update(kk_context_t*);
+
+uint8_t kk_dbsdk_loader__Loaded_isValid(kk_box_t, kk_context_t*);
+intptr_t kk_dbsdk_loader__Loaded_data(kk_box_t, kk_context_t*);
+uint32_t kk_dbsdk_loader__Loaded_size(kk_box_t, kk_context_t*);
+kk_string_t kk_dbsdk_loader__Loaded_text(kk_box_t, kk_context_t*);
+
+static inline kk_unit_t dbsdk_loader__loader_setBudget(uint32_t frameBytes, float frameMs) {
+  loader_setBudget(frameBytes, frameMs);
+  return kk_Unit;
+}
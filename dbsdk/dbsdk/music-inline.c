@@ -0,0 +1,15 @@
+uint8_t kk_dbsdk_music__music_beginLoadSoundfont(kk_string_t path, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  uint8_t result = music_beginLoadSoundfont((const char*)cstr);
+  kk_string_drop(path, ctx);
+  return result;
+}
+
+uint8_t kk_dbsdk_music__music_playMidi(kk_string_t path, uint8_t loop, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  uint8_t result = music_playMidi((const char*)cstr, loop);
+  kk_string_drop(path, ctx);
+  return result;
+}
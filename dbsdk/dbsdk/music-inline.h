@@ -0,0 +1,19 @@
+uint8_t kk_dbsdk_music__music_beginLoadSoundfont(kk_string_t, kk_context_t*);
+uint8_t kk_dbsdk_music__music_playMidi(kk_string_t, uint8_t, kk_context_t*);
+
+static inline kk_unit_t dbsdk_music__music_update(void) {
+  music_update();
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_music__music_setVolume(float volume) {
+  music_setVolume(volume);
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_music__music_setReverb(uint8_t enabled) {
+  music_setReverb(enabled);
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_music__music_clearCache(void) {
+  music_clearCache();
+  return kk_Unit;
+}
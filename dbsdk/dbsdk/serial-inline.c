@@ -0,0 +1,152 @@
+// Writers and readers are freed with their buffers once Koka drops the last
+// reference to them.
+
+static void kk_dbsdk_serial__free_Writer(void *writer_ptr, kk_block_t *b, kk_context_t *ctx) {
+  kk_unused(ctx);
+  serial_Writer *writer = (serial_Writer*)writer_ptr;
+  if (writer != NULL) {
+    serial_freeWriter(writer);
+    free(writer);
+  }
+}
+
+static void kk_dbsdk_serial__free_Reader(void *reader_ptr, kk_block_t *b, kk_context_t *ctx) {
+  kk_unused(ctx);
+  serial_Reader *reader = (serial_Reader*)reader_ptr;
+  if (reader != NULL) {
+    serial_freeReader(reader);
+    free(reader);
+  }
+}
+
+kk_box_t kk_dbsdk_serial__new_Writer(uint32_t capacity, kk_context_t *ctx) {
+  serial_Writer *writer = malloc(sizeof(serial_Writer));
+  serial_initWriter(writer, capacity);
+  return kk_cptr_raw_box(&kk_dbsdk_serial__free_Writer, writer, ctx);
+}
+
+kk_unit_t kk_dbsdk_serial__writeInt(kk_box_t writer_boxed_ptr, int64_t value, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  serial_writeSigned(writer, value);
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+kk_unit_t kk_dbsdk_serial__writeUint(kk_box_t writer_boxed_ptr, uint64_t value, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  serial_writeVarint(writer, value);
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+kk_unit_t kk_dbsdk_serial__writeFloat64(kk_box_t writer_boxed_ptr, double value, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  serial_writeFloat64(writer, value);
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+// The UTF-8 bytes are copied straight out of the Koka string.
+kk_unit_t kk_dbsdk_serial__writeString(kk_box_t writer_boxed_ptr, kk_string_t str, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  kk_ssize_t len;
+  const uint8_t *bytes = kk_string_buf_borrow(str, &len, ctx);
+  serial_writeString(writer, (const char*)bytes, (uint32_t)len);
+  kk_string_drop(str, ctx);
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+uint32_t kk_dbsdk_serial__Writer_size(kk_box_t writer_boxed_ptr, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  uint32_t size = writer->len;
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return size;
+}
+
+uint8_t kk_dbsdk_serial__saveFile(kk_box_t writer_boxed_ptr, kk_string_t path, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  uint8_t result = serial_saveFile(writer, (const char*)cstr);
+  kk_string_drop(path, ctx);
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return result;
+}
+
+kk_box_t kk_dbsdk_serial__loadFile(kk_string_t path, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  serial_Reader *reader = malloc(sizeof(serial_Reader));
+  if (!serial_loadFile(reader, (const char*)cstr)) reader->error = 1;
+  kk_string_drop(path, ctx);
+  return kk_cptr_raw_box(&kk_dbsdk_serial__free_Reader, reader, ctx);
+}
+
+// Read back what a writer holds, e.g. to restore a quick-resume snapshot kept
+// in memory. The reader gets its own copy, so the writer can be reused.
+kk_box_t kk_dbsdk_serial__Writer_reader(kk_box_t writer_boxed_ptr, kk_context_t *ctx) {
+  serial_Writer *writer = (serial_Writer*)kk_cptr_raw_unbox_borrowed(writer_boxed_ptr, ctx);
+  serial_Reader *reader = malloc(sizeof(serial_Reader));
+  uint8_t *data = malloc(writer->len > 0 ? writer->len : 1);
+  if (data != NULL) memcpy(data, writer->data, writer->len);
+  serial_initReader(reader, data, data != NULL ? writer->len : 0);
+  reader->ownsData = 1;
+  reader->error = data == NULL || writer->error;
+  kk_box_drop(writer_boxed_ptr, ctx);
+  return kk_cptr_raw_box(&kk_dbsdk_serial__free_Reader, reader, ctx);
+}
+
+uint8_t kk_dbsdk_serial__Reader_isValid(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint8_t isValid = !reader->error;
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return isValid;
+}
+
+int64_t kk_dbsdk_serial__readInt(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  int64_t value = serial_readSigned(reader);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return value;
+}
+
+uint64_t kk_dbsdk_serial__readUint(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint64_t value = serial_readVarint(reader);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return value;
+}
+
+// Every element takes at least a byte, so counts larger than the remaining
+// data are rejected.
+uint32_t kk_dbsdk_serial__readCount(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint32_t count = serial_readCount(reader, 1);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return count;
+}
+
+double kk_dbsdk_serial__readFloat64(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  double value = serial_readFloat64(reader);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return value;
+}
+
+// The Koka string is built directly from the serialized bytes.
+kk_string_t kk_dbsdk_serial__readString(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint32_t len;
+  const char *bytes = serial_readString(reader, &len);
+  kk_string_t str = kk_string_alloc_from_qutf8n(len, bytes != NULL ? bytes : "", ctx);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return str;
+}
+
+uint8_t kk_dbsdk_serial__Reader_hasError(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  serial_Reader *reader = (serial_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint8_t hasError = reader->error;
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return hasError;
+}
@@ -0,0 +1,17 @@
+kk_box_t kk_dbsdk_serial__new_Writer(uint32_t, kk_context_t*);
+kk_unit_t kk_dbsdk_serial__writeInt(kk_box_t, int64_t, kk_context_t*);
+kk_unit_t kk_dbsdk_serial__writeUint(kk_box_t, uint64_t, kk_context_t*);
+kk_unit_t kk_dbsdk_serial__writeFloat64(kk_box_t, double, kk_context_t*);
+kk_unit_t kk_dbsdk_serial__writeString(kk_box_t, kk_string_t, kk_context_t*);
+uint32_t kk_dbsdk_serial__Writer_size(kk_box_t, kk_context_t*);
+uint8_t kk_dbsdk_serial__saveFile(kk_box_t, kk_string_t, kk_context_t*);
+
+kk_box_t kk_dbsdk_serial__loadFile(kk_string_t, kk_context_t*);
+kk_box_t kk_dbsdk_serial__Writer_reader(kk_box_t, kk_context_t*);
+uint8_t kk_dbsdk_serial__Reader_isValid(kk_box_t, kk_context_t*);
+int64_t kk_dbsdk_serial__readInt(kk_box_t, kk_context_t*);
+uint64_t kk_dbsdk_serial__readUint(kk_box_t, kk_context_t*);
+uint32_t kk_dbsdk_serial__readCount(kk_box_t, kk_context_t*);
+double kk_dbsdk_serial__readFloat64(kk_box_t, kk_context_t*);
+kk_string_t kk_dbsdk_serial__readString(kk_box_t, kk_context_t*);
+uint8_t kk_dbsdk_serial__Reader_hasError(kk_box_t, kk_context_t*);
@@ -0,0 +1,88 @@
+// Samples are boxed so Koka's reference counting releases them. Emitters are
+// plain sound_handle integers, so updating them every frame never allocates.
+
+static void kk_dbsdk_sound__free_Sample(void *sample_ptr, kk_block_t *b, kk_context_t *ctx) {
+  kk_unused(ctx);
+  sound_sample *sample = (sound_sample*)sample_ptr;
+  if (sample != NULL) {
+    sound_releaseSample(*sample);
+    free(sample);
+  }
+}
+
+static kk_box_t kk_dbsdk_sound__box_Sample(sound_sample loaded, kk_context_t *ctx) {
+  sound_sample *sample = malloc(sizeof(sound_sample));
+  *sample = loaded;
+  return kk_cptr_raw_box(&kk_dbsdk_sound__free_Sample, sample, ctx);
+}
+
+kk_box_t kk_dbsdk_sound__sound_loadWav(kk_string_t path, uint8_t stereoMode, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  IOFILE *file = fs_open((const char*)cstr, IO_FILEMODE_READ);
+  kk_string_drop(path, ctx);
+
+  sound_sample sample = {-1, 0};
+  if (file != NULL) {
+    sample = sound_loadWavStereo(file, stereoMode);
+    fs_close(file);
+  }
+  return kk_dbsdk_sound__box_Sample(sample, ctx);
+}
+
+kk_box_t kk_dbsdk_sound__sound_loadWavBytes(intptr_t data, uint8_t stereoMode, kk_context_t *ctx) {
+  return kk_dbsdk_sound__box_Sample(sound_loadWavBytesStereo((const uint8_t*)data, stereoMode), ctx);
+}
+
+kk_box_t kk_dbsdk_sound__sound_loadWavBytesLen(intptr_t data, uint32_t dataLen, uint8_t stereoMode, kk_context_t *ctx) {
+  return kk_dbsdk_sound__box_Sample(sound_loadWavBytesLen((const uint8_t*)data, dataLen, stereoMode), ctx);
+}
+
+uint8_t kk_dbsdk_sound__Sample_isValid(kk_box_t sample_boxed_ptr, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  uint8_t isValid = sample->handle != -1;
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return isValid;
+}
+
+uint32_t kk_dbsdk_sound__Sample_samplerate(kk_box_t sample_boxed_ptr, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  uint32_t samplerate = sample->samplerate;
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return samplerate;
+}
+
+uint32_t kk_dbsdk_sound__Sample_length(kk_box_t sample_boxed_ptr, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  uint32_t length = sample->length;
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return length;
+}
+
+kk_unit_t kk_dbsdk_sound__sound_playOneShot(uint8_t priority, kk_box_t sample_boxed_ptr, uint8_t reverb, float volume, float pitch, float pan, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  sound_playOneShot(priority, *sample, reverb, volume, pitch, pan);
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+kk_unit_t kk_dbsdk_sound__sound_playOneShot3D(uint8_t priority, kk_box_t sample_boxed_ptr, uint8_t reverb, float volume, float pitch, float x, float y, float z, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  sound_playOneShot3D(priority, *sample, reverb, volume, pitch, (Vec3){x, y, z}, attenModel, attenMinDistance, attenMaxDistance, attenRolloff);
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+uint32_t kk_dbsdk_sound__sound_play(uint8_t priority, kk_box_t sample_boxed_ptr, uint8_t reverb, uint8_t loop, float volume, float pitch, float pan, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  sound_handle handle = sound_play(priority, *sample, reverb, loop, volume, pitch, pan);
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return handle;
+}
+
+uint32_t kk_dbsdk_sound__sound_play3D(uint8_t priority, kk_box_t sample_boxed_ptr, uint8_t reverb, uint8_t loop, float volume, float pitch, float x, float y, float z, uint8_t attenModel, float attenMinDistance, float attenMaxDistance, float attenRolloff, kk_context_t *ctx) {
+  sound_sample *sample = (sound_sample*)kk_cptr_raw_unbox_borrowed(sample_boxed_ptr, ctx);
+  sound_handle handle = sound_play3D(priority, *sample, reverb, loop, volume, pitch, (Vec3){x, y, z}, attenModel, attenMinDistance, attenMaxDistance, attenRolloff);
+  kk_box_drop(sample_boxed_ptr, ctx);
+  return handle;
+}
@@ -0,0 +1,56 @@
+kk_box_t kk_dbsdk_sound__sound_loadWav(kk_string_t, uint8_t, kk_context_t*);
+kk_box_t kk_dbsdk_sound__sound_loadWavBytes(intptr_t, uint8_t, kk_context_t*);
+kk_box_t kk_dbsdk_sound__sound_loadWavBytesLen(intptr_t, uint32_t, uint8_t, kk_context_t*);
+
+uint8_t kk_dbsdk_sound__Sample_isValid(kk_box_t, kk_context_t*);
+uint32_t kk_dbsdk_sound__Sample_samplerate(kk_box_t, kk_context_t*);
+uint32_t kk_dbsdk_sound__Sample_length(kk_box_t, kk_context_t*);
+
+kk_unit_t kk_dbsdk_sound__sound_playOneShot(uint8_t, kk_box_t, uint8_t, float, float, float, kk_context_t*);
+kk_unit_t kk_dbsdk_sound__sound_playOneShot3D(uint8_t, kk_box_t, uint8_t, float, float, float, float, float, uint8_t, float, float, float, kk_context_t*);
+uint32_t kk_dbsdk_sound__sound_play(uint8_t, kk_box_t, uint8_t, uint8_t, float, float, float, kk_context_t*);
+uint32_t kk_dbsdk_sound__sound_play3D(uint8_t, kk_box_t, uint8_t, uint8_t, float, float, float, float, float, uint8_t, float, float, float, kk_context_t*);
+
+static inline kk_unit_t dbsdk_sound__sound_init(void) {
+  sound_init();
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_update(void) {
+  sound_update();
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_stop(uint32_t handle) {
+  sound_stop(handle);
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_destroy(uint32_t handle) {
+  sound_destroy(handle);
+  return kk_Unit;
+}
+static inline uint8_t dbsdk_sound__sound_isValid(uint32_t handle) {
+  sound_emitter *emitter = sound_getEmitter(handle);
+  return emitter != NULL && emitter->isValid;
+}
+static inline kk_unit_t dbsdk_sound__sound_setPosition(uint32_t handle, float x, float y, float z) {
+  sound_setPosition(handle, (Vec3){x, y, z});
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_setVolume(uint32_t handle, float volume) {
+  sound_emitter *emitter = sound_getEmitter(handle);
+  if (emitter != NULL) emitter->volume = volume;
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_setPitch(uint32_t handle, float pitch) {
+  sound_emitter *emitter = sound_getEmitter(handle);
+  if (emitter != NULL) emitter->pitch = pitch;
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_setPan(uint32_t handle, float pan) {
+  sound_emitter *emitter = sound_getEmitter(handle);
+  if (emitter != NULL) emitter->pan = pan;
+  return kk_Unit;
+}
+static inline kk_unit_t dbsdk_sound__sound_setListener(float x, float y, float z, float rx, float ry, float rz, float rw) {
+  sound_setListener((Vec3){x, y, z}, (Quaternion){rx, ry, rz, rw});
+  return kk_Unit;
+}
@@ -0,0 +1,104 @@
+// Readers own the file they were opened on, both are closed once Koka drops
+// the last reference to the reader.
+
+static void kk_dbsdk_stream__free_Reader(void *reader_ptr, kk_block_t *b, kk_context_t *ctx) {
+  kk_unused(ctx);
+  stream_Reader *reader = (stream_Reader*)reader_ptr;
+  if (reader != NULL) {
+    if (reader->file != NULL) fs_close(reader->file);
+    stream_close(reader);
+    free(reader);
+  }
+}
+
+kk_box_t kk_dbsdk_stream__stream_open(kk_string_t path, uint32_t blockSize, kk_context_t *ctx) {
+  kk_ssize_t len;
+  const uint8_t *cstr = kk_string_buf_borrow(path, &len, ctx);
+  stream_Reader *reader = malloc(sizeof(stream_Reader));
+  reader->file = fs_open((const char*)cstr, IO_FILEMODE_READ);
+  reader->buffer = NULL;
+  reader->ownsBuffer = 0;
+  kk_string_drop(path, ctx);
+
+  if (reader->file != NULL && !stream_open(reader, reader->file, blockSize)) {
+    fs_close(reader->file);
+    reader->file = NULL;
+  }
+  return kk_cptr_raw_box(&kk_dbsdk_stream__free_Reader, reader, ctx);
+}
+
+uint8_t kk_dbsdk_stream__Reader_isValid(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint8_t isValid = reader->file != NULL;
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return isValid;
+}
+
+// Read a little endian integer of 1, 2 or 4 bytes. Returns 0 past the end of the file.
+int32_t kk_dbsdk_stream__stream_readInt(kk_box_t reader_boxed_ptr, uint32_t size, uint8_t isSigned, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint8_t bytes[4] = {0, 0, 0, 0};
+  stream_read(reader, bytes, size);
+  kk_box_drop(reader_boxed_ptr, ctx);
+
+  uint32_t value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+  if (isSigned && size == 1) return (int8_t)value;
+  if (isSigned && size == 2) return (int16_t)value;
+  return (int32_t)value;
+}
+
+float kk_dbsdk_stream__stream_readFloat32(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  float value = 0.0f;
+  stream_read(reader, &value, sizeof(float));
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return value;
+}
+
+// Invalid UTF-8 in the data is replaced, so this is only meant for text.
+kk_string_t kk_dbsdk_stream__stream_readString(kk_box_t reader_boxed_ptr, uint32_t len, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  char *buf = malloc(len);
+  uint32_t read = buf != NULL ? stream_read(reader, buf, len) : 0;
+  kk_box_drop(reader_boxed_ptr, ctx);
+  kk_string_t str = kk_string_alloc_from_qutf8n(read, buf, ctx);
+  free(buf);
+  return str;
+}
+
+// Returns -1 at the end of the file.
+int32_t kk_dbsdk_stream__stream_peekByte(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  const uint8_t *next = stream_peek(reader, 1);
+  int32_t value = next != NULL ? *next : -1;
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return value;
+}
+
+kk_unit_t kk_dbsdk_stream__stream_skip(kk_box_t reader_boxed_ptr, uint32_t len, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  stream_skip(reader, len);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+kk_unit_t kk_dbsdk_stream__stream_seek(kk_box_t reader_boxed_ptr, uint32_t position, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  stream_seek(reader, position);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return kk_Unit;
+}
+
+uint32_t kk_dbsdk_stream__stream_tell(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint32_t position = stream_tell(reader);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return position;
+}
+
+uint8_t kk_dbsdk_stream__stream_eof(kk_box_t reader_boxed_ptr, kk_context_t *ctx) {
+  stream_Reader *reader = (stream_Reader*)kk_cptr_raw_unbox_borrowed(reader_boxed_ptr, ctx);
+  uint8_t eof = stream_eof(reader);
+  kk_box_drop(reader_boxed_ptr, ctx);
+  return eof;
+}
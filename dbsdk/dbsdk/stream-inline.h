@@ -0,0 +1,11 @@
+kk_box_t kk_dbsdk_stream__stream_open(kk_string_t, uint32_t, kk_context_t*);
+
+uint8_t kk_dbsdk_stream__Reader_isValid(kk_box_t, kk_context_t*);
+int32_t kk_dbsdk_stream__stream_readInt(kk_box_t, uint32_t, uint8_t, kk_context_t*);
+float kk_dbsdk_stream__stream_readFloat32(kk_box_t, kk_context_t*);
+kk_string_t kk_dbsdk_stream__stream_readString(kk_box_t, uint32_t, kk_context_t*);
+int32_t kk_dbsdk_stream__stream_peekByte(kk_box_t, kk_context_t*);
+kk_unit_t kk_dbsdk_stream__stream_skip(kk_box_t, uint32_t, kk_context_t*);
+kk_unit_t kk_dbsdk_stream__stream_seek(kk_box_t, uint32_t, kk_context_t*);
+uint32_t kk_dbsdk_stream__stream_tell(kk_box_t, kk_context_t*);
+uint8_t kk_dbsdk_stream__stream_eof(kk_box_t, kk_context_t*);
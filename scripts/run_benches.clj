@@ -0,0 +1,36 @@
+(ns run-benches
+  (:require
+    [babashka.fs :as fs]
+    [babashka.process :as proc]))
+
+;; Capture path to script when Babashka loads the file.
+(def ^:private self-path *file*)
+
+(defn- get-os []
+  (let [os (System/getProperty "os.name")]
+    (cond
+      (re-find #"Windows" os) "windows"
+      (re-find #"Linux" os) "ubuntu")))
+
+(defn- compile-bench [proj-root out-file]
+  (let [bench-dir (fs/path proj-root "bench")
+        sdk-dir (fs/path proj-root "dbsdk" "dbsdk" "c")
+        ;; All SDK C sources are compiled in, the host imports they call are
+        ;; provided by bench/stubs.c.
+        sources (concat (map str (fs/glob bench-dir "*.c"))
+                        (map str (fs/glob (fs/path sdk-dir "src") "*.c")))]
+    (fs/create-dirs (fs/parent out-file))
+    (apply proc/shell "cc" "-O2" "-std=gnu11"
+           (str "-I" (fs/path sdk-dir "include"))
+           (str "-I" bench-dir)
+           "-o" (str out-file)
+           (concat sources ["-lm"]))))
+
+;; Prints one JSON object per benchmark to stdout. Redirect to a file (e.g.
+;; bench_output.txt) to compare runs.
+(defn -main [& args]
+  (let [proj-root (-> self-path fs/parent fs/parent)
+        exe-name (if (= (get-os) "windows") "bench.exe" "bench")
+        out-file (fs/path proj-root "bench" ".build" exe-name)]
+    (compile-bench proj-root out-file)
+    (apply proc/shell (str out-file) *command-line-args*)))